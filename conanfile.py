@@ -12,8 +12,9 @@ class IsFrameTransformationServiceConan(ConanFile):
         "shared": [True, False],
         "fPIC": [True, False],
         "build_tests": [True, False],
+        "build_benchmarks": [True, False],
     }
-    default_options = "shared=False", "fPIC=True", "build_tests=False"
+    default_options = "shared=False", "fPIC=True", "build_tests=False", "build_benchmarks=False"
     generators = "cmake", "cmake_find_package", "cmake_paths", "virtualrunenv"
     requires = (
         "is-msgs/1.1.10@is/stable",
@@ -29,6 +30,8 @@ class IsFrameTransformationServiceConan(ConanFile):
     def build_requirements(self):
         if self.options.build_tests:
             self.build_requires("gtest/1.8.0@bincrafters/stable")
+        if self.options.build_benchmarks:
+            self.build_requires("benchmark/1.5.0")
 
     def configure(self):
         self.options["opencv"].with_qt = False
@@ -37,6 +40,7 @@ class IsFrameTransformationServiceConan(ConanFile):
         cmake = CMake(self, generator='Ninja')
         cmake.definitions["CMAKE_POSITION_INDEPENDENT_CODE"] = self.options.fPIC
         cmake.definitions["enable_tests"] = self.options.build_tests
+        cmake.definitions["enable_benchmarks"] = self.options.build_benchmarks
         cmake.configure()
         cmake.build()
         if self.options.build_tests:
@@ -0,0 +1,258 @@
+#include "calibration-cache.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include <boost/range.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <is/msgs/io.hpp>
+#include <is/wire/core/logger.hpp>
+#include <thread>
+
+namespace is {
+
+namespace {
+
+// Changes whenever the layout of the cache changes
+constexpr char cache_magic[8] = {'I', 'S', 'F', 'T', 'C', 'A', 'L', '1'};
+
+// Read-only memory map of a whole file
+class MappedFile {
+  void* data;
+  std::size_t length;
+
+ public:
+  explicit MappedFile(std::string const& path) : data(MAP_FAILED), length(0) {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+      length = static_cast<std::size_t>(info.st_size);
+      data = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+  }
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+  ~MappedFile() {
+    if (data != MAP_FAILED) ::munmap(data, length);
+  }
+
+  auto begin() const -> char const* {
+    return data != MAP_FAILED ? static_cast<char const*>(data) : nullptr;
+  }
+  auto end() const -> char const* { return begin() ? begin() + length : nullptr; }
+};
+
+// Bounds checked cursor over the cache contents
+class Reader {
+  char const* it;
+  char const* end;
+
+ public:
+  Reader(char const* first, char const* last) : it(first), end(last) {}
+
+  auto bytes(std::size_t n, char const** out) -> bool {
+    if (static_cast<std::size_t>(end - it) < n) return false;
+    *out = it;
+    it += n;
+    return true;
+  }
+
+  template <typename T>
+  auto value(T* out) -> bool {
+    char const* raw;
+    if (!bytes(sizeof(T), &raw)) return false;
+    std::memcpy(out, raw, sizeof(T));
+    return true;
+  }
+
+  auto string(std::string* out) -> bool {
+    auto size = uint32_t{};
+    char const* raw;
+    if (!value(&size) || !bytes(size, &raw)) return false;
+    out->assign(raw, size);
+    return true;
+  }
+};
+
+class Writer {
+  std::ofstream& out;
+
+ public:
+  explicit Writer(std::ofstream& o) : out(o) {}
+
+  template <typename T>
+  void value(T const& in) {
+    out.write(reinterpret_cast<char const*>(&in), sizeof(T));
+  }
+
+  void string(std::string const& in) {
+    value(static_cast<uint32_t>(in.size()));
+    out.write(in.data(), in.size());
+  }
+};
+
+void add_extrinsics(vision::CameraCalibration const& calibration, CalibrationSet* set) {
+  for (auto const& transformation : calibration.extrinsic()) {
+    try {
+      set->extrinsics.emplace_back(Edge{transformation.from(), transformation.to()},
+                                   to_pose(transformation.tf()));
+    } catch (std::invalid_argument const& e) {
+      is::warn("source=CalibrationServer event=InvalidExtrinsic id={} error='{}'",
+               calibration.id(), e.what());
+    }
+  }
+}
+
+}  // namespace
+
+auto list_calibration_files(std::string const& folder) -> std::vector<CalibrationFile> {
+  namespace fs = boost::filesystem;
+  auto files = std::vector<CalibrationFile>{};
+  if (!fs::is_directory(folder)) return files;
+
+  for (auto& entry : boost::make_iterator_range(fs::directory_iterator(folder), {})) {
+    struct stat info;
+    if (::stat(entry.path().c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+    auto mtime = int64_t{info.st_mtim.tv_sec} * 1000000000 + info.st_mtim.tv_nsec;
+    files.push_back(CalibrationFile{entry.path().filename().string(), mtime,
+                                    static_cast<uint64_t>(info.st_size)});
+  }
+  std::sort(files.begin(), files.end(),
+            [](CalibrationFile const& l, CalibrationFile const& r) { return l.name < r.name; });
+  return files;
+}
+
+auto parse_calibration_files(std::string const& folder, std::vector<CalibrationFile> const& files)
+    -> CalibrationSet {
+  auto parsed = std::vector<boost::optional<vision::CameraCalibration>>(files.size());
+  auto errors = std::vector<std::string>(files.size());
+
+  // Files are handed out one at a time, so a slow file does not hold back a whole chunk
+  std::atomic<std::size_t> next{0};
+  auto parse = [&] {
+    for (auto i = next++; i < files.size(); i = next++) {
+      auto file = (boost::filesystem::path{folder} / files[i].name).string();
+      try {
+        auto calibration = vision::CameraCalibration{};
+        is::load(file, &calibration);
+        parsed[i] = std::move(calibration);
+      } catch (std::runtime_error const& e) { errors[i] = e.what(); }
+    }
+  };
+
+  auto n_threads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                         files.size());
+  auto workers = std::vector<std::thread>{};
+  for (std::size_t i = 1; i < n_threads; ++i) { workers.emplace_back(parse); }
+  parse();
+  for (auto& worker : workers) { worker.join(); }
+
+  auto set = CalibrationSet{};
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    if (!parsed[i]) {
+      is::warn("source=CalibrationServer event=LoadFailed file={} error='{}'", files[i].name,
+               errors[i]);
+      continue;
+    }
+    add_extrinsics(*parsed[i], &set);
+    set.calibrations.push_back(std::move(*parsed[i]));
+  }
+  return set;
+}
+
+auto read_calibration_cache(std::string const& path, std::vector<CalibrationFile> const& files)
+    -> boost::optional<CalibrationSet> {
+  MappedFile mapped{path};
+  if (!mapped.begin()) return boost::none;
+  auto reader = Reader{mapped.begin(), mapped.end()};
+
+  char const* magic;
+  if (!reader.bytes(sizeof cache_magic, &magic) ||
+      std::memcmp(magic, cache_magic, sizeof cache_magic) != 0) {
+    return boost::none;
+  }
+
+  auto n_files = uint64_t{};
+  if (!reader.value(&n_files) || n_files != files.size()) return boost::none;
+  for (auto const& file : files) {
+    auto cached = CalibrationFile{};
+    if (!reader.string(&cached.name) || !reader.value(&cached.mtime) ||
+        !reader.value(&cached.size) || !(cached == file)) {
+      return boost::none;
+    }
+  }
+
+  auto set = CalibrationSet{};
+  auto n_calibrations = uint64_t{};
+  if (!reader.value(&n_calibrations)) return boost::none;
+  set.calibrations.resize(n_calibrations);
+  for (auto& calibration : set.calibrations) {
+    auto size = uint32_t{};
+    char const* raw;
+    if (!reader.value(&size) || !reader.bytes(size, &raw) ||
+        !calibration.ParseFromArray(raw, static_cast<int>(size))) {
+      return boost::none;
+    }
+  }
+
+  // Extrinsics are stored as raw poses, so they are ready to be used without any conversion
+  auto n_extrinsics = uint64_t{};
+  if (!reader.value(&n_extrinsics)) return boost::none;
+  set.extrinsics.reserve(n_extrinsics);
+  for (uint64_t i = 0; i < n_extrinsics; ++i) {
+    auto from = int64_t{};
+    auto to = int64_t{};
+    auto pose = Pose{};
+    if (!reader.value(&from) || !reader.value(&to) || !reader.value(&pose.data)) {
+      return boost::none;
+    }
+    set.extrinsics.emplace_back(Edge{from, to}, pose);
+  }
+  return set;
+}
+
+void write_calibration_cache(std::string const& path, std::vector<CalibrationFile> const& files,
+                             CalibrationSet const& set) {
+  // Written aside and then renamed, so a concurrent reader never sees a partial cache
+  auto temporary = path + ".tmp";
+  {
+    std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+    auto writer = Writer{out};
+    out.write(cache_magic, sizeof cache_magic);
+    writer.value(static_cast<uint64_t>(files.size()));
+    for (auto const& file : files) {
+      writer.string(file.name);
+      writer.value(file.mtime);
+      writer.value(file.size);
+    }
+
+    writer.value(static_cast<uint64_t>(set.calibrations.size()));
+    for (auto const& calibration : set.calibrations) {
+      writer.string(calibration.SerializeAsString());
+    }
+
+    writer.value(static_cast<uint64_t>(set.extrinsics.size()));
+    for (auto const& edge_and_pose : set.extrinsics) {
+      writer.value(edge_and_pose.first.from);
+      writer.value(edge_and_pose.first.to);
+      writer.value(edge_and_pose.second.data);
+    }
+
+    if (!out) {
+      is::warn("source=CalibrationServer event=CacheWriteFailed path={}", path);
+      return;
+    }
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    is::warn("source=CalibrationServer event=CacheWriteFailed path={}", path);
+  }
+}
+
+}  // namespace is
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <is/msgs/camera.pb.h>
+#include <boost/optional.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+#include "frame-conversion/frame-conversion.hpp"
+
+namespace is {
+
+// File on the calibrations directory, identified by its name, modification time and size
+struct CalibrationFile {
+  std::string name;
+  int64_t mtime;
+  uint64_t size;
+
+  auto operator==(CalibrationFile const& other) const -> bool {
+    return name == other.name && mtime == other.mtime && size == other.size;
+  }
+};
+
+// Everything needed at startup from the calibrations directory
+struct CalibrationSet {
+  std::vector<vision::CameraCalibration> calibrations;
+  // Extrinsics of every calibration, ready to be inserted on the FrameConversion
+  std::vector<std::pair<Edge, Pose>> extrinsics;
+};
+
+// Regular files on the directory, sorted by name
+auto list_calibration_files(std::string const& folder) -> std::vector<CalibrationFile>;
+
+// Parse the calibration files using every available core
+auto parse_calibration_files(std::string const& folder, std::vector<CalibrationFile> const& files)
+    -> CalibrationSet;
+
+/* Binary cache of a CalibrationSet, read through a memory map. The cache is only valid for the
+  exact list of files (names, modification times and sizes) it was created from, reading it
+  returns nothing otherwise. */
+auto read_calibration_cache(std::string const& path, std::vector<CalibrationFile> const& files)
+    -> boost::optional<CalibrationSet>;
+void write_calibration_cache(std::string const& path, std::vector<CalibrationFile> const& files,
+                             CalibrationSet const&);
+
+}  // namespace is
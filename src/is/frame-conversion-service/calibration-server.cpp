@@ -1,50 +1,118 @@
-
 #include "calibration-server.hpp"
 #include <boost/filesystem.hpp>
-#include <boost/range.hpp>
-#include <is/msgs/io.hpp>
+#include <chrono>
+#include "calibration-cache.hpp"
 
 namespace is {
 
-auto load_calibrations(std::string const& folder) -> std::vector<vision::CameraCalibration> {
-  namespace fs = boost::filesystem;
-  std::vector<is::vision::CameraCalibration> calibrations;
-
-  if (!fs::is_directory(folder)) {
+static auto load_calibrations(std::string const& folder, std::string const& cache,
+                              std::vector<CalibrationFile> const& files) -> CalibrationSet {
+  if (!boost::filesystem::is_directory(folder)) {
     is::warn("source=CalibrationServer event=LoadFailed path={} error='not a directory'", folder);
-    return calibrations;
+    return CalibrationSet{};
   }
 
-  for (auto& entry : boost::make_iterator_range(fs::directory_iterator(folder), {})) {
-    auto file = entry.path().string();
-    try {
-      is::vision::CameraCalibration calibration;
-      is::load(file, &calibration);
-      calibrations.push_back(calibration);
-    } catch (std::runtime_error const& e) {
-      is::warn("source=CalibrationServer event=LoadFailed file={} error='{}'", file, e.what());
+  auto started_at = std::chrono::steady_clock::now();
+  auto elapsed_ms = [&] {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                 started_at)
+        .count();
+  };
+
+  if (!cache.empty()) {
+    auto cached = read_calibration_cache(cache, files);
+    if (cached) {
+      is::info("source=CalibrationServer event=CacheHit files={} took_ms={}", files.size(),
+               elapsed_ms());
+      return std::move(*cached);
     }
   }
-  return calibrations;
+
+  auto set = parse_calibration_files(folder, files);
+  is::info("source=CalibrationServer event=Parsed files={} took_ms={}", files.size(),
+           elapsed_ms());
+  if (!cache.empty()) write_calibration_cache(cache, files, set);
+  return set;
+}
+
+// Extrinsics indexed by their sorted edge, so the direction they were given does not matter
+static auto index_extrinsics(std::vector<std::pair<Edge, Pose>> const& extrinsics)
+    -> std::unordered_map<Edge, std::pair<Edge, Pose>, EdgeHash> {
+  auto indexed = std::unordered_map<Edge, std::pair<Edge, Pose>, EdgeHash>{};
+  for (auto const& edge_and_pose : extrinsics) {
+    auto key = sorted(edge_and_pose.first);
+    indexed.erase(key);
+    indexed.emplace(key, edge_and_pose);
+  }
+  return indexed;
 }
 
-CalibrationServer::CalibrationServer(std::string const& path) {
-  for (auto const& calibration : load_calibrations(path)) {
-    _calibrations[calibration.id()] = calibration;
+CalibrationServer::CalibrationServer(std::string const& path, std::string const& cache_path)
+    : folder(path), cache(cache_path), files(list_calibration_files(path)) {
+  auto set = load_calibrations(folder, cache, files);
+  _extrinsics = std::move(set.extrinsics);
+  set_calibrations(std::move(set.calibrations));
+}
+
+void CalibrationServer::set_calibrations(std::vector<vision::CameraCalibration>&& loaded) {
+  auto calibrations = std::make_shared<Calibrations>();
+  for (auto& calibration : loaded) {
     is::info("source=CalibrationServer event=NewCalibration id={}", calibration.id());
+    auto id = calibration.id();
+    (*calibrations)[id] = std::move(calibration);
   }
+  std::atomic_store(&_calibrations, std::shared_ptr<Calibrations const>{calibrations});
 }
 
-auto CalibrationServer::calibrations() const
-    -> std::unordered_map<int64_t, vision::CameraCalibration> const& {
-  return _calibrations;
+auto CalibrationServer::calibrations() const -> std::shared_ptr<Calibrations const> {
+  return std::atomic_load(&_calibrations);
+}
+
+auto CalibrationServer::extrinsics() const -> std::vector<std::pair<Edge, Pose>> const& {
+  return _extrinsics;
+}
+
+auto CalibrationServer::reload() -> CalibrationDiff {
+  auto current_files = list_calibration_files(folder);
+  if (current_files == files) return CalibrationDiff{};
+
+  files = current_files;
+  auto set = load_calibrations(folder, cache, files);
+
+  auto diff = CalibrationDiff{};
+  auto before = index_extrinsics(_extrinsics);
+  auto after = index_extrinsics(set.extrinsics);
+  for (auto const& key_and_extrinsic : after) {
+    auto const& edge = key_and_extrinsic.second.first;
+    auto const& pose = key_and_extrinsic.second.second;
+    auto old = before.find(key_and_extrinsic.first);
+    if (old != before.end() && old->second.first == edge && old->second.second.data == pose.data) {
+      continue;
+    }
+    auto transformation = diff.updated.add_tfs();
+    transformation->set_from(edge.from);
+    transformation->set_to(edge.to);
+    *transformation->mutable_tf() = to_tensor(pose);
+  }
+  for (auto const& key_and_extrinsic : before) {
+    if (after.count(key_and_extrinsic.first)) continue;
+    diff.removed.push_back(key_and_extrinsic.second.first);
+  }
+
+  _extrinsics = std::move(set.extrinsics);
+  set_calibrations(std::move(set.calibrations));
+  is::info("source=CalibrationServer event=Reloaded files={} updated={} removed={}", files.size(),
+           diff.updated.tfs_size(), diff.removed.size());
+  return diff;
 }
 
 auto CalibrationServer::get_calibration(Context*, vision::GetCalibrationRequest const& request,
                                         vision::GetCalibrationReply* reply) -> wire::Status {
+  // Same calibrations for the whole request even if they are reloaded meanwhile
+  auto current = calibrations();
   for (auto&& id : request.ids()) {
-    auto it = _calibrations.find(id);
-    if (it == _calibrations.end())
+    auto it = current->find(id);
+    if (it == current->end())
       return make_status(wire::StatusCode::NOT_FOUND,
                          fmt::format("CameraCalibration with id \"{}\" not found", id));
     *reply->add_calibrations() = it->second;
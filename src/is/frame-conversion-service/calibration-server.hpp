@@ -2,20 +2,54 @@
 
 #include <is/msgs/camera.pb.h>
 #include <is/wire/rpc.hpp>
+#include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include "calibration-cache.hpp"
+#include "frame-conversion/frame-conversion.hpp"
 
 namespace is {
 
+// Changes on the extrinsics after the calibrations are reloaded
+struct CalibrationDiff {
+  // New extrinsics or extrinsics with a different transformation
+  vision::FrameTransformations updated;
+  // Extrinsics that are no longer on any calibration
+  std::vector<Edge> removed;
+
+  auto empty() const -> bool { return updated.tfs_size() == 0 && removed.empty(); }
+};
+
 class CalibrationServer {
-  std::unordered_map<int64_t, vision::CameraCalibration> _calibrations;
+ public:
+  using Calibrations = std::unordered_map<int64_t, vision::CameraCalibration>;
+
+ private:
+  std::string folder;
+  std::string cache;
+  // Files the calibrations were loaded from
+  std::vector<CalibrationFile> files;
+  // Replaced as a whole on every reload, always accessed through std::atomic_load/atomic_store
+  std::shared_ptr<Calibrations const> _calibrations;
+  std::vector<std::pair<Edge, Pose>> _extrinsics;
+
+  void set_calibrations(std::vector<vision::CameraCalibration>&&);
 
  public:
-  CalibrationServer(std::string const& path);
+  // Uses the binary cache on the given path if it is up to date, creating it otherwise
+  CalibrationServer(std::string const& path, std::string const& cache = "");
+
+  auto calibrations() const -> std::shared_ptr<Calibrations const>;
+  // Extrinsics of all the calibrations, in a form that can be inserted in bulk
+  auto extrinsics() const -> std::vector<std::pair<Edge, Pose>> const&;
 
-  auto calibrations() const -> std::unordered_map<int64_t, vision::CameraCalibration> const&;
+  /* Load the calibrations again if any file changed, returning what changed on the extrinsics.
+    Must not be called concurrently with itself or extrinsics(). */
+  auto reload() -> CalibrationDiff;
 
   auto get_calibration(Context*, vision::GetCalibrationRequest const& request,
                        vision::GetCalibrationReply* reply) -> wire::Status;
 };
 
-}  // namespace is
\ No newline at end of file
+}  // namespace is
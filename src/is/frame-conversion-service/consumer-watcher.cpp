@@ -1,99 +1,86 @@
 #include "consumer-watcher.hpp"
-#include <algorithm>
 #include <is/msgs/utils.hpp>
 #include <is/wire/core/logger.hpp>
 #include <iterator>
+#include "topic-router.hpp"
 
 namespace is {
 
-ConsumerWatcher::ConsumerWatcher(Subscription* subscription) {
-  subscription->subscribe("BrokerEvents.Consumers");
+ConsumerWatcher::ConsumerWatcher(Subscription* subscription) : generation(0) {
+  if (subscription) subscription->subscribe("BrokerEvents.Consumers");
 }
 
 void ConsumerWatcher::on_new_consumer(
-    std::function<void(std::string const&, std::string const&)> const& callback) {
+    std::function<void(Path const&, std::string const&)> const& callback) {
   new_consumer = callback;
 }
 
-void ConsumerWatcher::on_no_consumers(std::function<void(std::string const&)> const& callback) {
+void ConsumerWatcher::on_no_consumers(std::function<void(Path const&)> const& callback) {
   no_consumers = callback;
 }
 
 void ConsumerWatcher::run(Message const& msg) {
-  if (msg.topic() != "BrokerEvents.Consumers") { return; }
-  auto new_info = msg.unpack<common::ConsumerList>()->info();
-
-  using ConsumerVector = std::vector<std::pair<std::string, common::ConsumerInfo>>;
-
-  // Converts Map: Topic -> ConsumerInfo to vector
-  auto new_consumers = ConsumerVector{};
-  new_consumers.reserve(new_info.size());
-  std::copy(new_info.cbegin(), new_info.cend(), std::back_inserter(new_consumers));
-
-  // Filter only the topics we are interested using the regexp
-  auto re = std::regex{"FrameTransformation(?:\\.\\d+){2,}"};
-  new_consumers.erase(
-      std::remove_if(new_consumers.begin(), new_consumers.end(),
-                     [&](auto const& key_pair) { return !std::regex_match(key_pair.first, re); }),
-      new_consumers.end());
-
-  std::sort(new_consumers.begin(), new_consumers.end(),
-            [](auto const& l, auto const& r) { return l.first < r.first; });
-
-  auto create_topic_projection = [](ConsumerVector const& from) {
-    auto topics = std::vector<std::string>{};
-    topics.reserve(from.size());
-    std::transform(from.begin(), from.end(), std::back_inserter(topics),
-                   [](auto const& el) { return el.first; });
-    return topics;
-  };
-
-  auto new_topics = create_topic_projection(new_consumers);
-  auto old_topics = create_topic_projection(consumers);
-
-  auto deleted = std::vector<std::string>{};
-  std::set_difference(old_topics.begin(), old_topics.end(), new_topics.begin(), new_topics.end(),
-                      std::inserter(deleted, deleted.begin()));
-  for (auto const& topic : deleted) {
-    is::info("source=ConsumerWatcher event=NoConsumers topic={}", topic);
-    no_consumers(topic);
-  }
-
-  auto created = std::vector<std::string>{};
-  std::set_difference(new_topics.begin(), new_topics.end(), old_topics.begin(), old_topics.end(),
-                      std::inserter(created, created.begin()));
-  for (auto const& topic : created) {
-    is::info("source=ConsumerWatcher event=NewConsumer topic={}", topic);
-    new_consumer(topic, topic);
+  auto list = msg.unpack<common::ConsumerList>();
+  if (!list) {
+    is::warn("source=ConsumerWatcher event=BadSchema");
+    return;
   }
 
-  auto intersection = std::vector<std::string>{};
-  std::set_intersection(new_topics.begin(), new_topics.end(), old_topics.begin(), old_topics.end(),
-                        std::back_inserter(intersection));
+  // The broker always sends the full list, only the differences to the previous one are reported
+  ++generation;
+  for (auto const& topic_and_info : list->info()) {
+    auto const& name = topic_and_info.first;
+    auto const& consumers = topic_and_info.second.consumers();
 
-  for (auto const& topic : intersection) {
-    auto comparator = [](auto const& l, auto const& r) { return l.first < r; };
-    auto old = std::lower_bound(consumers.begin(), consumers.end(), topic, comparator);
-    auto now = std::lower_bound(new_consumers.begin(), new_consumers.end(), topic, comparator);
-    assert(now != new_consumers.end() && old != consumers.end());
-
-    auto oldc = old->second.mutable_consumers();
-    std::sort(oldc->begin(), oldc->end());
-
-    auto newc = now->second.mutable_consumers();
-    std::sort(newc->begin(), newc->end());
-
-    auto added = std::vector<std::string>{};
-    std::set_difference(newc->begin(), newc->end(), oldc->begin(), oldc->end(),
-                        std::inserter(added, added.begin()));
+    auto it = topics.find(name);
+    auto created = it == topics.end();
+    if (created) {
+      it = topics.emplace(name, Topic{parse_path(name), {}, generation}).first;
+    }
+    auto& topic = it->second;
+    topic.generation = generation;
+    if (!topic.path) continue;
+
+    // Consumers still on the list are marked with its generation, as well as the new ones
+    auto marked = std::size_t{0};
+    for (auto const& consumer : consumers) {
+      auto inserted = topic.consumers.emplace(consumer, generation);
+      if (!inserted.second) {
+        // Repeated on the same list
+        if (inserted.first->second == generation) continue;
+        inserted.first->second = generation;
+      } else if (!created) {
+        is::info("source=ConsumerWatcher event=NewConsumer topic={} consumer={}", name, consumer);
+        new_consumer(*topic.path, consumer);
+      }
+      ++marked;
+    }
+    if (created) {
+      is::info("source=ConsumerWatcher event=NewConsumer topic={}", name);
+      new_consumer(*topic.path, name);
+    }
 
-    for (auto const& consumer : added) {
-      is::info("source=ConsumerWatcher event=NewConsumer topic={} consumer={}", topic, consumer);
-      new_consumer(topic, consumer);
+    // Some consumers left, even if as many joined, forget them so they are reported again if
+    // they come back
+    if (topic.consumers.size() > marked) {
+      for (auto consumer = topic.consumers.begin(); consumer != topic.consumers.end();) {
+        consumer = consumer->second == generation ? std::next(consumer)
+                                                  : topic.consumers.erase(consumer);
+      }
     }
   }
 
-  consumers = new_consumers;
+  for (auto it = topics.begin(); it != topics.end();) {
+    if (it->second.generation == generation) {
+      ++it;
+      continue;
+    }
+    if (it->second.path) {
+      is::info("source=ConsumerWatcher event=NoConsumers topic={}", it->first);
+      no_consumers(*it->second.path);
+    }
+    it = topics.erase(it);
+  }
 }
 
 }  // namespace is
@@ -1,28 +1,44 @@
 #pragma once
 
 #include <is/msgs/common.pb.h>
+#include <boost/optional.hpp>
 #include <functional>
 #include <is/wire/core.hpp>
-#include <regex>
 #include <string>
-#include <vector>
+#include <unordered_map>
+#include "frame-conversion/frame-conversion.hpp"
 
 namespace is {
 
 /* Watches BrokerEvents for new/no consumers on topics with the FrameTransformation.<IDs...>
- * pattern*/
+ * pattern. Messages are dispatched to it by the TopicRouter on BrokerEvents.Consumers */
 class ConsumerWatcher {
-  std::vector<std::pair<std::string, common::ConsumerInfo>> consumers;
+  /* State of every topic seen on the last consumer list. Topics are classified and parsed only
+    the first time they are seen, then each list is applied with hash lookups only. */
+  struct Topic {
+    // Requested path, none for the topics that are not FrameTransformation.<IDs...>
+    boost::optional<Path> path;
+    // Consumers along with the last consumer list they were on, the others left the topic
+    std::unordered_map<std::string, uint64_t> consumers;
+    // Last consumer list the topic was on, topics left behind lost all their consumers
+    uint64_t generation;
+  };
+  std::unordered_map<std::string, Topic> topics;
+  uint64_t generation;
+
   //  (path, consumer) -> void
-  std::function<void(std::string const&, std::string const&)> new_consumer;
+  std::function<void(Path const&, std::string const&)> new_consumer;
   //  (path) -> void
-  std::function<void(std::string const&)> no_consumers;
+  std::function<void(Path const&)> no_consumers;
 
  public:
+  // Without a subscription (e.g. when replaying) the messages must be delivered by the caller
   ConsumerWatcher(Subscription*);
-  void on_new_consumer(std::function<void(std::string const&, std::string const&)> const& callback);
-  void on_no_consumers(std::function<void(std::string const&)> const& callback);
+  /* Called once with the topic itself as the consumer when a path gets its first consumers, and
+    once for each consumer that joins a path that already had some */
+  void on_new_consumer(std::function<void(Path const&, std::string const&)> const& callback);
+  void on_no_consumers(std::function<void(Path const&)> const& callback);
   void run(Message const&);
 };
 
-}  // namespace is
\ No newline at end of file
+}  // namespace is
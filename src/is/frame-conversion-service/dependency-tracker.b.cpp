@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include "dependency-tracker.hpp"
+#include "frame-conversion/benchmark-support.hpp"
+
+namespace {
+
+// Same graphs as the frame-conversion benchmarks
+void graph_sizes(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"topology", "frames"});
+  for (auto topology : {is::Topology::Star, is::Topology::Chain, is::Topology::Bipartite}) {
+    for (auto frames : {10, 100, 1000, 10000, 50000}) {
+      bench->Args({static_cast<int64_t>(topology), frames});
+    }
+  }
+}
+
+// Paths tracked on each benchmark, as if there were this many subscriptions
+constexpr auto n_dependencies = int64_t{1000};
+
+void BM_DependencyTrackerUpdate(benchmark::State& state) {
+  auto topology = static_cast<is::Topology>(state.range(0));
+  auto n_frames = state.range(1);
+  state.SetLabel(is::topology_name(topology));
+
+  std::mt19937 gen(42);
+  auto edges = is::synthetic_graph(topology, n_frames, gen);
+  auto conversions = is::FrameConversion{is::FrameConversion::Mode::Rigid};
+  conversions.update_transformations(edges);
+
+  // Paths from random frames to frame 0, which most of them pass through
+  auto tracker = is::DependencyTracker{&conversions};
+  std::uniform_int_distribution<int64_t> frame(1, n_frames - 1);
+  for (int64_t i = 0; i < std::min(n_dependencies, n_frames - 1); ++i) {
+    tracker.update_dependency(is::Path{frame(gen), 0});
+  }
+
+  /* New poses for the existing edges, so the topology never changes. Two rounds, so no update
+    repeats the pose already stored, which would be skipped. */
+  auto tfs = std::vector<is::vision::FrameTransformation>{};
+  for (int round = 0; round < 2; ++round) {
+    for (auto const& edge_and_pose : edges) {
+      auto tf = is::vision::FrameTransformation{};
+      tf.set_from(edge_and_pose.first.from);
+      tf.set_to(edge_and_pose.first.to);
+      *tf.mutable_tf() = is::to_tensor(is::random_pose(gen));
+      tfs.push_back(tf);
+    }
+  }
+
+  auto i = std::size_t{0};
+  auto updated = uint64_t{0};
+  auto on_update = [&](is::Path const&, is::vision::FrameTransformation const&) { ++updated; };
+  auto allocations = is::allocation_count();
+  for (auto _ : state) { tracker.update(tfs[i++ % tfs.size()], on_update); }
+
+  auto n_allocations = static_cast<double>(is::allocation_count() - allocations);
+  state.counters["allocs"] = benchmark::Counter(n_allocations, benchmark::Counter::kAvgIterations);
+  state.counters["updated_paths"] =
+      benchmark::Counter(static_cast<double>(updated), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_DependencyTrackerUpdate)->Apply(graph_sizes);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -11,92 +11,314 @@ I adjacent_for_each(I first, I last, P&& predicate) {
   return second;
 }
 
-DependencyTracker::DependencyTracker(FrameConversion* c) : conversions(c) {}
+namespace {
+
+// Order of the ids does not matter, so they are removed by swapping with the last one
+void remove_id(std::vector<PathId>* ids, PathId id) {
+  auto it = std::find(ids->begin(), ids->end(), id);
+  if (it == ids->end()) return;
+  *it = ids->back();
+  ids->pop_back();
+}
+
+}  // namespace
+
+DependencyTracker::DependencyTracker(FrameConversion* c)
+    : n_resolved(0),
+      n_unresolved(0),
+      update_count(0),
+      unresolved_version(c->components_version()),
+      conversions(c),
+      recompute_latency(nullptr),
+      retries(0) {}
+
+void DependencyTracker::measure_recompute(LatencyHistogram* histogram) {
+  recompute_latency = histogram;
+}
+
+auto DependencyTracker::unresolved_retries() const -> uint64_t {
+  return retries;
+}
+
+auto DependencyTracker::resolved_size() const -> std::size_t {
+  return n_resolved;
+}
+
+auto DependencyTracker::unresolved_size() const -> std::size_t {
+  return n_unresolved;
+}
+
+auto DependencyTracker::segments_size() const -> std::size_t {
+  return segment_paths.size();
+}
+
+auto DependencyTracker::canonical(Path const& path) const -> Path {
+  auto to_root = conversions->keeps_tree(path.back());
+  auto from_root = conversions->keeps_tree(path.front());
+  if (to_root != from_root) return to_root ? path : inverted(path);
+  auto backward = inverted(path);
+  return path <= backward ? path : backward;
+}
+
+auto DependencyTracker::transformation(Path const& path, Pose const& pose) const
+    -> vision::FrameTransformation {
+  vision::FrameTransformation transformation;
+  transformation.set_from(path.front());
+  transformation.set_to(path.back());
+  *(transformation.mutable_tf()) = to_tensor(pose);
+  return transformation;
+}
+
+auto DependencyTracker::track(Path const& path) -> PathId {
+  auto id = paths.intern(path);
+  if (id >= dependencies.size()) dependencies.resize(id + 1, Dependency{});
+  return id;
+}
+
+auto DependencyTracker::compose_hops(Path const& segment) const -> CompositionTree {
+  auto hops = std::vector<Pose>{};
+  hops.reserve(segment.size() - 1);
+  adjacent_for_each(segment.begin(), segment.end(),
+                    [&](int64_t from, int64_t to) { hops.push_back(conversions->hop(from, to)); });
+  return CompositionTree{hops};
+}
+
+auto DependencyTracker::compose(std::vector<Piece> const& pieces) const -> Pose {
+  auto tf = Pose::identity();
+  for (auto&& piece : pieces) {
+    auto const& result = segments[piece.segment].composition.result();
+    tf = (piece.backward ? conversions->invert(result) : result) * tf;
+  }
+  return tf;
+}
+
+auto DependencyTracker::acquire_segment(Path const& frames) -> Piece {
+  auto key = canonical(frames);
+  auto id = segment_paths.intern(key);
+  if (id >= segments.size()) segments.resize(id + 1, Segment{CompositionTree{}, 0, 0});
+
+  auto& segment = segments[id];
+  if (segment.users++ == 0 || segment.updated != update_count) {
+    // New, or might go through an edge changed on this update that its other routes did not see
+    segment.composition = compose_hops(key);
+    segment.updated = update_count;
+  }
+  return Piece{id, key != frames};
+}
+
+void DependencyTracker::release_segment(PathId id) {
+  auto& segment = segments[id];
+  if (--segment.users > 0) return;
+  segment.composition = CompositionTree{};
+  segment_paths.release(id);
+}
+
+auto DependencyTracker::split(PathId id, Path const& route) -> std::vector<Piece> {
+  // Hints of the requested path are hubs too, its route is the concatenation of the routes in
+  // between them
+  auto const& path = paths.path(id);
+  auto hints = Path{path.begin() + 1, path.end() - 1};
+  auto is_hub = [&](int64_t frame) {
+    return conversions->keeps_tree(frame) ||
+           std::find(hints.begin(), hints.end(), frame) != hints.end();
+  };
+
+  auto pieces = std::vector<Piece>{};
+  auto first = route.begin();
+  for (auto it = route.begin() + 1; it != route.end(); ++it) {
+    if (it + 1 != route.end() && !is_hub(*it)) continue;
+    pieces.push_back(acquire_segment(Path{first, it + 1}));
+    first = it;
+  }
+  return pieces;
+}
 
 auto DependencyTracker::update_dependency(Path const& path)
     -> boost::optional<vision::FrameTransformation> {
-  auto had_route = direct_dependencies.find(path) != direct_dependencies.end();
-  auto route = conversions->find_path(path);
+  auto key = canonical(path);
+  auto id = track(key);
+  auto backward = key != path;
+  (backward ? dependencies[id].backward : dependencies[id].forward) = true;
 
-  auto maybe_transformation = boost::optional<vision::FrameTransformation>{};
+  auto maybe_pose = resolve(id, {});
+  if (!maybe_pose) return boost::none;
+  return transformation(path, backward ? conversions->invert(*maybe_pose) : *maybe_pose);
+}
+
+auto DependencyTracker::resolve(PathId id, std::vector<Edge> const& changed)
+    -> boost::optional<Pose> {
+  auto& dependency = dependencies[id];
+  auto const& path = paths.path(id);
+  auto had_route = !dependency.route.empty();
+  auto route = conversions->find_path(path);
 
   if (!route) {
     if (had_route) {
       info("event=Dependency.BecameUnreachable path={}", path);
-      remove_dependency(path);
+      remove_route(id);
     }
-    auto it_and_ok = unresolved_dependencies.insert(path);
-    if (it_and_ok.second) { info("event=Dependency.AddUnresolved path={}", path); }
+    if (add_unresolved(id)) { info("event=Dependency.AddUnresolved path={}", path); }
+    return boost::none;
+  }
+
+  if (!had_route) {
+    add_route(id, *route);
+  } else if (dependency.route != *route) {
+    info("event=Dependency.NewRoute path={} route={}", path, *route);
+    // New route is different, remove the old one and add the new one
+    remove_route(id);
+    add_route(id, *route);
   } else {
-    if (had_route) {
-      auto old_route = direct_dependencies.find(path)->second;
-      if (old_route != route) {
-        info("event=Dependency.NewRoute path={} route={}", path, *route);
-        // New route is different, remove the old one and add the new one
-        remove_dependency(path);
-        add_dependency(path, *route);
+    // Same route, recompose only the hops of its segments that go through the changed edges,
+    // segments shared with routes recomposed before on this update are already up to date
+    for (auto&& piece : dependency.pieces) {
+      auto& segment = segments[piece.segment];
+      if (segment.updated == update_count) continue;
+      segment.updated = update_count;
+      auto const& frames = segment_paths.path(piece.segment);
+      for (std::size_t hop = 0; hop + 1 < frames.size(); ++hop) {
+        auto key = sorted(Edge{frames[hop], frames[hop + 1]});
+        auto is_changed = std::any_of(changed.begin(), changed.end(),
+                                      [&](Edge const& edge) { return sorted(edge) == key; });
+        if (is_changed) {
+          segment.composition.update(hop, conversions->hop(frames[hop], frames[hop + 1]));
+        }
       }
-    } else {
-      add_dependency(path, *route);
     }
-
-    vision::FrameTransformation transformation;
-    transformation.set_from(path.front());
-    transformation.set_to(path.back());
-    *(transformation.mutable_tf()) = conversions->compose_path(*route);
-    maybe_transformation = transformation;
   }
-  return maybe_transformation;
+  return compose(dependency.pieces);
 }
 
-void DependencyTracker::add_dependency(Path const& path, Path const& route) {
+void DependencyTracker::add_route(PathId id, Path const& route) {
+  auto const& path = paths.path(id);
   info("event=Dependency.AddDirect key={} value={}", path, route);
-  direct_dependencies[path] = route;
+  remove_unresolved(id);
+  auto& dependency = dependencies[id];
+  dependency.route = route;
+  dependency.pieces = split(id, route);
+  ++n_resolved;
+
   auto insert_each_edge = [&](int64_t from, int64_t to) {
     auto sorted_key = sorted(Edge{from, to});
+    auto& ids = reverse_dependencies[sorted_key];
+    // Routes with hints may walk the same edge more than once
+    if (std::find(ids.begin(), ids.end(), id) != ids.end()) return;
     info("event=Dependency.AddReverse key={} value={}", sorted_key, path);
-    reverse_dependencies[sorted_key].insert(path);
+    ids.push_back(id);
   };
   adjacent_for_each(route.begin(), route.end(), insert_each_edge);
 }
 
+void DependencyTracker::remove_route(PathId id) {
+  auto& dependency = dependencies[id];
+  if (dependency.route.empty()) return;
+  auto const& path = paths.path(id);
+
+  auto remove_each_edge = [&](int64_t from, int64_t to) {
+    auto edge = sorted(Edge{from, to});
+    auto reverse_it = reverse_dependencies.find(edge);
+    // Already removed if the route walks the edge more than once
+    if (reverse_it == reverse_dependencies.end()) return;
+    remove_id(&reverse_it->second, id);
+    if (reverse_it->second.empty()) reverse_dependencies.erase(reverse_it);
+    info("event=Dependency.DelReverse key={} value={}", edge, path);
+  };
+  adjacent_for_each(dependency.route.begin(), dependency.route.end(), remove_each_edge);
+
+  // Release the segments, dropping the ones no other route walks
+  for (auto&& piece : dependency.pieces) { release_segment(piece.segment); }
+  dependency.route.clear();
+  dependency.pieces.clear();
+  --n_resolved;
+  info("event=Dependency.DelDirect key={}", path);
+}
+
 void DependencyTracker::remove_dependency(Path const& path) {
-  auto direct_it = direct_dependencies.find(path);
-  if (direct_it != direct_dependencies.end()) {
-    auto remove_each_edge = [&](int64_t from, int64_t to) {
-      auto edge = sorted(Edge{from, to});
-      auto reverse_it = reverse_dependencies.find(edge);
-      if (reverse_it == reverse_dependencies.end()) { critical("?"); }
-      reverse_it->second.erase(path);
-      info("event=Dependency.DelReverse key={} value={}", edge, path);
-    };
-
-    // Remove each edge of the reverse dependencies
-    auto reverse_keys = direct_it->second;
-    adjacent_for_each(reverse_keys.begin(), reverse_keys.end(), remove_each_edge);
-
-    // Remove the direct dependency
-    direct_dependencies.erase(direct_it);
-    info("event=Dependency.DelDirect key={}", path);
+  auto key = canonical(path);
+  auto maybe_id = paths.find(key);
+  if (!maybe_id) return;
+  auto id = *maybe_id;
+
+  auto& dependency = dependencies[id];
+  (key != path ? dependency.backward : dependency.forward) = false;
+  // Still requested on the other direction
+  if (dependency.forward || dependency.backward) return;
+
+  if (!dependency.route.empty()) {
+    remove_route(id);
   } else {
-    // Remove from the unresolved dependencies
-    unresolved_dependencies.erase(path);
-    info("event=Dependency.DelUnresolved key={}", path);
+    remove_unresolved(id);
+    info("event=Dependency.DelUnresolved key={}", key);
   }
+  dependencies[id] = Dependency{};
+  paths.release(id);
 }
 
-void DependencyTracker::invalidate_edge(Edge const& edge) {
+auto DependencyTracker::invalidate_edge(Edge const& edge) -> std::vector<PathId> {
   auto sorted_key = sorted(edge);
   auto it = reverse_dependencies.find(sorted_key);
-  if (it != reverse_dependencies.end()) {
-    info("event=InvalidateEdge key={}", sorted_key);
-    auto paths = std::vector<Path>{it->second.begin(), it->second.end()};
-    for (auto const& path : paths) {
-      remove_dependency(path);
-      unresolved_dependencies.insert(path);
+  if (it == reverse_dependencies.end()) return {};
+
+  info("event=InvalidateEdge key={}", sorted_key);
+  // Copied since removing the routes removes them from reverse_dependencies
+  auto ids = it->second;
+  for (auto id : ids) {
+    remove_route(id);
+    add_unresolved(id);
+  }
+  return ids;
+}
+
+auto DependencyTracker::add_unresolved(PathId id) -> bool {
+  refresh_unresolved();
+  auto& dependency = dependencies[id];
+  auto component = conversions->component(paths.path(id).front());
+  auto is_new = !dependency.unresolved;
+  if (is_new) {
+    ++n_unresolved;
+  } else {
+    auto bucket = unresolved_components.find(dependency.component);
+    if (bucket != unresolved_components.end()) {
+      remove_id(&bucket->second, id);
+      if (bucket->second.empty()) unresolved_components.erase(bucket);
     }
-    reverse_dependencies.erase(sorted_key);
   }
+  dependency.unresolved = true;
+  dependency.component = component;
+  unresolved_components[component].push_back(id);
+  return is_new;
+}
+
+void DependencyTracker::remove_unresolved(PathId id) {
+  auto& dependency = dependencies[id];
+  if (!dependency.unresolved) return;
+  auto bucket = unresolved_components.find(dependency.component);
+  if (bucket != unresolved_components.end()) {
+    remove_id(&bucket->second, id);
+    if (bucket->second.empty()) unresolved_components.erase(bucket);
+  }
+  dependency.unresolved = false;
+  --n_unresolved;
+}
+
+void DependencyTracker::refresh_unresolved() {
+  if (unresolved_version == conversions->components_version()) return;
+  unresolved_version = conversions->components_version();
+  unresolved_components.clear();
+  for (PathId id = 0; id < dependencies.size(); ++id) {
+    auto& dependency = dependencies[id];
+    if (!dependency.unresolved) continue;
+    dependency.component = conversions->component(paths.path(id).front());
+    unresolved_components[dependency.component].push_back(id);
+  }
+}
+
+auto DependencyTracker::merging_components(Edge const& edge) -> std::vector<int64_t> {
+  refresh_unresolved();
+  auto from = conversions->component(edge.from);
+  auto to = conversions->component(edge.to);
+  if (from == to) return {};
+  return {from, to};
 }
 
-}  // namespace is
\ No newline at end of file
+}  // namespace is
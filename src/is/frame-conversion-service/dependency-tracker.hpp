@@ -2,80 +2,289 @@
 
 #include <is/msgs/camera.pb.h>
 #include <is/wire/core/logger.hpp>
+#include <algorithm>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
+#include "frame-conversion/composition-tree.hpp"
 #include "frame-conversion/frame-conversion.hpp"
+#include "latency-histogram.hpp"
+#include "path-table.hpp"
 
 namespace is {
 
+/* Paths requested on both directions, e.g. "FrameTransformation.1.2" and
+  "FrameTransformation.2.1", are tracked once on their canonical direction (see canonical()) and
+  the other one is served by inverting the composed result. Routes are also split on hub frames,
+  the roots of the shortest path trees and the hints of the requested path, and each of those
+  segments is composed once and shared by every route that walks it. */
 class DependencyTracker {
-  /* Mapping between the user desired transformation and the full path, e.g:
-    Path{1 -> 2}: Path{1 -> 10 -> 3 -> 2} */
-  std::unordered_map<Path, Path, PathHash> direct_dependencies;
+  // Part of a route in between two hubs, or its ends, walked on the direction of the route
+  struct Piece {
+    // Handle of the canonical segment on "segment_paths"
+    PathId segment;
+    // If the route walks the segment backwards
+    bool backward;
+  };
 
-  /* Maps which Paths depend on the given Edge, e.g (for the example before this would be):
+  /* State of a canonical path, indexed by its handle on "paths". A path is either resolved, with
+    its full route, e.g. Path{1 -> 2}: Path{1 -> 10 -> 3 -> 2}, or unresolved, along with the
+    connected component of its first frame. A path can only become solvable when that component
+    is merged with another one, so unresolved paths are bucketed by it and retried only when that
+    happens. */
+  struct Dependency {
+    // Directions in which the path was requested
+    bool forward;
+    bool backward;
+    // Empty while the path is unresolved
+    Path route;
+    std::vector<Piece> pieces;
+    bool unresolved;
+    int64_t component;
+  };
+  PathTable paths;
+  std::vector<Dependency> dependencies;
+  std::size_t n_resolved;
+  std::size_t n_unresolved;
+
+  /* Partial products of the hops of each segment, indexed by its handle on "segment_paths", so an
+    update on a single edge recomputes only O(log n) products of the segment, and a segment
+    shared by many routes is recomposed only once per update */
+  struct Segment {
+    CompositionTree composition;
+    // Number of pieces of routes on this segment, zero for released handles
+    std::size_t users;
+    // Update on which the segment was last recomposed
+    uint64_t updated;
+  };
+  PathTable segment_paths;
+  std::vector<Segment> segments;
+  // Incremented on every update
+  uint64_t update_count;
+
+  /* Maps which canonical paths depend on the given Edge, e.g (for the example before this would
+    be):
     Edge{1 -> 10}: [ Path{1 -> 2} ]
     Edge{2 -> 3}:  [ Path{1 -> 2} ]
     Edge{3 -> 10}: [ Path{1 -> 2} ]
   */
-  std::unordered_map<Edge, std::unordered_set<Path, PathHash>, EdgeHash> reverse_dependencies;
+  std::unordered_map<Edge, std::vector<PathId>, EdgeHash> reverse_dependencies;
 
-  // Keep track of paths that we were unable to solve.
-  std::unordered_set<Path, PathHash> unresolved_dependencies;
+  // Unresolved paths by the component of their first frame, e.g: Component 1: [ Path{1 -> 2} ]
+  std::unordered_map<int64_t, std::vector<PathId>> unresolved_components;
+  // Components version used to bucket the unresolved dependencies
+  uint64_t unresolved_version;
 
   // Transformation graph solver.
   FrameConversion* conversions;
 
+  // Time spent recomposing the paths after each update, if set
+  LatencyHistogram* recompute_latency;
+  // Number of times an unresolved path was tried again
+  uint64_t retries;
+
+  // Reused by every update, so the fan-out of an edge does not allocate
+  std::vector<PathId> fanout;
+  // (path, index of a transformation that changed an edge of its route) of a batch
+  std::vector<std::pair<PathId, int>> affected;
+  std::vector<Edge> changed_edges;
+
+  // Retry the unresolved paths on the buckets of the given components
+  template <typename F>
+  void check_unresolved_dependencies(std::vector<int64_t> const& components, F const& on_update);
+  // Report the new pose of a canonical path on every direction it was requested
   template <typename F>
-  void check_unresolved_dependencies(F const& on_update);
+  void notify(PathId, Pose const& pose, F const& on_update);
 
-  void add_dependency(Path const& path, Path const& route);
+  /* Direction on which a path is tracked. Paths ending at a root of a shortest path tree are
+    kept on that direction so their routes come from the tree, the others are ordered by their
+    frames. */
+  auto canonical(Path const&) const -> Path;
+  auto transformation(Path const&, Pose const&) const -> vision::FrameTransformation;
+  // Handle of a canonical path, with room for its state
+  auto track(Path const& canonical) -> PathId;
+
+  // Returns true if the path was not unresolved before
+  auto add_unresolved(PathId) -> bool;
+  void remove_unresolved(PathId);
+  // Bucket the unresolved paths again if the components were renumbered by an edge removal
+  void refresh_unresolved();
+  // Components that will be merged by the insertion of the given edge
+  auto merging_components(Edge const&) -> std::vector<int64_t>;
+
+  void add_route(PathId, Path const& route);
+  void remove_route(PathId);
+  // Move every path that depends on the given edge to the unresolved ones, returning them
+  auto invalidate_edge(Edge const&) -> std::vector<PathId>;
+  // Split the route of the given canonical path on its hubs, acquiring its segments
+  auto split(PathId, Path const& route) -> std::vector<Piece>;
+  auto acquire_segment(Path const& frames) -> Piece;
+  void release_segment(PathId);
+  // Build the partial products of every hop of the given segment
+  auto compose_hops(Path const& segment) const -> CompositionTree;
+  // Product of the segments of a route
+  auto compose(std::vector<Piece> const&) const -> Pose;
+  /* Find the route of a canonical path again and compose it, only the hops over the changed
+    edges are recomposed if the route did not change. Returns none if there is no route. */
+  auto resolve(PathId, std::vector<Edge> const& changed) -> boost::optional<Pose>;
 
  public:
   DependencyTracker(FrameConversion* conversions);
 
+  // Record on the given histogram the time spent recomposing the paths after each update
+  void measure_recompute(LatencyHistogram*);
+  auto unresolved_retries() const -> uint64_t;
+  // Number of canonical paths with a route and without one
+  auto resolved_size() const -> std::size_t;
+  auto unresolved_size() const -> std::size_t;
+  // Number of distinct segments composed for all the routes
+  auto segments_size() const -> std::size_t;
+
   auto update_dependency(Path const&) -> boost::optional<vision::FrameTransformation>;
   void remove_dependency(Path const&);
-  void invalidate_edge(Edge const&);
 
   template <typename F>
   void update(vision::FrameTransformation const& tf, F const& on_update);
+
+  /* Apply all the transformations of the message before recomputing anything, so each path
+    affected by any of them is recomposed and reported only once. Invalid transformations are
+    skipped. */
+  template <typename F>
+  void update_batch(vision::FrameTransformations const& tfs, F const& on_update);
+  // Same as before, but the poses are also kept on the history of their edges with the given time
+  template <typename F>
+  void update_batch(vision::FrameTransformations const& tfs,
+                    boost::optional<FrameConversion::Timestamp> const& stamp, F const& on_update);
+
+  // Remove the transformation of the given edge, rerouting the paths that depended on it
+  template <typename F>
+  void remove(Edge const& edge, F const& on_update);
 };
 
 template <typename F>
 void DependencyTracker::update(vision::FrameTransformation const& tf, F const& on_update) {
-  conversions->update_transformation(tf);
-
   auto edge = Edge{tf.from(), tf.to()};
+  auto components = merging_components(edge);
+  // Same pose as before, the edge already existed so no component was merged either
+  if (!conversions->update_transformation(tf)) return;
+  auto latency = ScopedLatency{recompute_latency};
+  ++update_count;
+
   // Find all paths that depend on this edge
   auto reverse_it = reverse_dependencies.find(sorted(edge));
   if (reverse_it != reverse_dependencies.end()) {
-    // Copy the paths since an update can modify reverse_dependencies and thus invalidate our
-    // iterator
-    std::vector<Path> paths(reverse_it->second.begin(), reverse_it->second.end());
-    // Update each dependent path
-    for (auto&& path : paths) {
-      auto maybe_transformation = update_dependency(path);
-      if (maybe_transformation) { on_update(path, *maybe_transformation); }
+    // Copy the handles since an update can reroute a path, modifying reverse_dependencies
+    fanout.assign(reverse_it->second.begin(), reverse_it->second.end());
+    changed_edges.clear();
+    changed_edges.push_back(edge);
+    for (auto id : fanout) {
+      auto maybe_pose = resolve(id, changed_edges);
+      if (maybe_pose) notify(id, *maybe_pose, on_update);
+    }
+  }
+
+  check_unresolved_dependencies(components, on_update);
+}
+
+template <typename F>
+void DependencyTracker::update_batch(vision::FrameTransformations const& tfs,
+                                     F const& on_update) {
+  update_batch(tfs, boost::none, on_update);
+}
+
+template <typename F>
+void DependencyTracker::update_batch(vision::FrameTransformations const& tfs,
+                                     boost::optional<FrameConversion::Timestamp> const& stamp,
+                                     F const& on_update) {
+  auto components = std::vector<int64_t>{};
+  affected.clear();
+
+  for (int i = 0; i < tfs.tfs_size(); ++i) {
+    auto const& tf = tfs.tfs(i);
+    auto edge = Edge{tf.from(), tf.to()};
+    auto merged = merging_components(edge);
+    auto changed = false;
+    try {
+      changed = stamp ? conversions->update_transformation(tf, *stamp)
+                      : conversions->update_transformation(tf);
+    } catch (std::invalid_argument const& e) {
+      warn("event=Dependency.InvalidTransformation edge={} error='{}'", edge, e.what());
+      continue;
     }
+    if (!changed) continue;
+    components.insert(components.end(), merged.begin(), merged.end());
+
+    auto reverse_it = reverse_dependencies.find(sorted(edge));
+    if (reverse_it == reverse_dependencies.end()) continue;
+    for (auto id : reverse_it->second) { affected.emplace_back(id, i); }
   }
 
-  check_unresolved_dependencies(on_update);
+  auto latency = ScopedLatency{recompute_latency};
+  ++update_count;
+  // Group the changed edges of each path, recomposing it only once
+  std::sort(affected.begin(), affected.end());
+  for (auto first = affected.begin(); first != affected.end();) {
+    auto id = first->first;
+    changed_edges.clear();
+    for (; first != affected.end() && first->first == id; ++first) {
+      auto const& tf = tfs.tfs(first->second);
+      changed_edges.emplace_back(tf.from(), tf.to());
+    }
+    auto maybe_pose = resolve(id, changed_edges);
+    if (maybe_pose) notify(id, *maybe_pose, on_update);
+  }
+
+  std::sort(components.begin(), components.end());
+  components.erase(std::unique(components.begin(), components.end()), components.end());
+  check_unresolved_dependencies(components, on_update);
+}
+
+template <typename F>
+void DependencyTracker::remove(Edge const& edge, F const& on_update) {
+  auto ids = invalidate_edge(edge);
+  conversions->remove_transformation(edge);
+  auto latency = ScopedLatency{recompute_latency};
+
+  // Unresolved paths are only retried on merges, but these may still have another route
+  retries += ids.size();
+  for (auto id : ids) {
+    auto maybe_pose = resolve(id, {});
+    if (maybe_pose) {
+      info("event=Dependency.Resolved key={}", paths.path(id));
+      notify(id, *maybe_pose, on_update);
+    }
+  }
 }
 
 template <typename F>
-void DependencyTracker::check_unresolved_dependencies(F const& on_update) {
-  std::vector<Path> paths(unresolved_dependencies.begin(), unresolved_dependencies.end());
-
-  for (auto&& path : paths) {
-    auto maybe_transformation = update_dependency(path);
-    if (maybe_transformation) {
-      info("event=Dependency.Resolved key={}", path);
-      on_update(path, *maybe_transformation);
-      unresolved_dependencies.erase(path);
+void DependencyTracker::check_unresolved_dependencies(std::vector<int64_t> const& components,
+                                                      F const& on_update) {
+  for (auto component : components) {
+    auto bucket = unresolved_components.find(component);
+    if (bucket == unresolved_components.end()) continue;
+    // Paths that are still unresolved are moved to the bucket of the merged component
+    auto ids = std::move(bucket->second);
+    unresolved_components.erase(bucket);
+    retries += ids.size();
+
+    for (auto id : ids) {
+      auto maybe_pose = resolve(id, {});
+      if (maybe_pose) {
+        info("event=Dependency.Resolved key={}", paths.path(id));
+        notify(id, *maybe_pose, on_update);
+      }
     }
   }
 }
 
+template <typename F>
+void DependencyTracker::notify(PathId id, Pose const& pose, F const& on_update) {
+  auto const& dependency = dependencies[id];
+  auto const& path = paths.path(id);
+  if (dependency.forward) on_update(path, transformation(path, pose));
+  if (dependency.backward) {
+    auto backward = inverted(path);
+    on_update(backward, transformation(backward, conversions->invert(pose)));
+  }
+}
+
 }  // namespace is
\ No newline at end of file
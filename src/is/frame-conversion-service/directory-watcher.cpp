@@ -0,0 +1,61 @@
+#include "directory-watcher.hpp"
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <is/wire/core/logger.hpp>
+
+namespace is {
+
+DirectoryWatcher::DirectoryWatcher(std::string const& p)
+    : fd(::inotify_init1(IN_CLOEXEC)), path(p) {
+  if (fd < 0) {
+    is::warn("source=DirectoryWatcher event=InitFailed error='{}'", std::strerror(errno));
+    return;
+  }
+  auto mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+              IN_DELETE_SELF | IN_MOVE_SELF;
+  if (::inotify_add_watch(fd, path.c_str(), mask) < 0) {
+    is::warn("source=DirectoryWatcher event=WatchFailed path={} error='{}'", path,
+             std::strerror(errno));
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+  if (fd >= 0) ::close(fd);
+}
+
+auto DirectoryWatcher::valid() const -> bool {
+  return fd >= 0;
+}
+
+auto DirectoryWatcher::drain() -> bool {
+  // Large enough for many events at once, they are only counted, not inspected
+  alignas(inotify_event) char buffer[4096];
+  auto n_read = ::read(fd, buffer, sizeof buffer);
+  return n_read > 0;
+}
+
+auto DirectoryWatcher::wait(std::chrono::milliseconds quiet) -> bool {
+  if (!valid()) return false;
+
+  auto request = pollfd{fd, POLLIN, 0};
+  // Block until the first event
+  while (::poll(&request, 1, -1) < 0) {
+    if (errno != EINTR) return false;
+  }
+  if (!drain()) return false;
+
+  // Then wait for the burst to end
+  for (;;) {
+    auto ready = ::poll(&request, 1, static_cast<int>(quiet.count()));
+    if (ready == 0) return true;
+    if (ready < 0 && errno != EINTR) return false;
+    if (ready > 0 && !drain()) return false;
+  }
+}
+
+}  // namespace is
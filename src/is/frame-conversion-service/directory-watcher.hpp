@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace is {
+
+// Waits for files to be created, modified, moved or removed on a directory, using inotify
+class DirectoryWatcher {
+  int fd;
+  std::string path;
+
+  // Discard the pending events, returns false if there were none
+  auto drain() -> bool;
+
+ public:
+  explicit DirectoryWatcher(std::string const& path);
+  DirectoryWatcher(DirectoryWatcher const&) = delete;
+  DirectoryWatcher& operator=(DirectoryWatcher const&) = delete;
+  ~DirectoryWatcher();
+
+  auto valid() const -> bool;
+  /* Blocks until something changes on the directory. Since a single change usually generates a
+    burst of events (e.g. editors writing a temporary file and renaming it) it only returns after
+    the directory has been quiet for the given interval. Returns false if the watch failed. */
+  auto wait(std::chrono::milliseconds quiet = std::chrono::milliseconds(500)) -> bool;
+};
+
+}  // namespace is
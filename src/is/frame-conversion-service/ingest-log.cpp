@@ -0,0 +1,119 @@
+#include "ingest-log.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <is/wire/core/logger.hpp>
+
+namespace is {
+
+namespace {
+
+// Changes whenever the layout of the records changes
+constexpr char log_magic[8] = {'I', 'S', 'F', 'T', 'L', 'O', 'G', '2'};
+
+template <typename T>
+void append(std::string* buffer, T const& value) {
+  buffer->append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+auto extract(std::string const& buffer, std::size_t* offset, T* value) -> bool {
+  if (buffer.size() - *offset < sizeof(T)) return false;
+  std::memcpy(value, buffer.data() + *offset, sizeof(T));
+  *offset += sizeof(T);
+  return true;
+}
+
+}  // namespace
+
+IngestRecorder::IngestRecorder(std::string const& path)
+    : file(path, std::ios::binary | std::ios::trunc) {
+  if (!file) {
+    warn("source=IngestRecorder event=OpenFailed path={}", path);
+    return;
+  }
+  file.write(log_magic, sizeof log_magic);
+}
+
+auto IngestRecorder::good() const -> bool {
+  return file.good();
+}
+
+void IngestRecorder::record(IngestRecord::Kind kind, Message const& message,
+                            std::chrono::system_clock::time_point received_at) {
+  if (!file) return;
+  auto const& topic = message.topic();
+  auto const& body = message.body();
+  auto topic_size = static_cast<uint16_t>(std::min<std::size_t>(topic.size(), UINT16_MAX));
+  auto nanoseconds = [](std::chrono::system_clock::time_point time) {
+    return static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+  };
+
+  buffer.clear();
+  append(&buffer, static_cast<uint8_t>(kind));
+  append(&buffer, nanoseconds(received_at));
+  append(&buffer, nanoseconds(message.created_at()));
+  append(&buffer, topic_size);
+  buffer.append(topic.data(), topic_size);
+  append(&buffer, static_cast<uint8_t>(message.content_type()));
+  buffer.append(body.data(), body.size());
+
+  auto size = static_cast<uint32_t>(buffer.size());
+  file.write(reinterpret_cast<char const*>(&size), sizeof size);
+  file.write(buffer.data(), buffer.size());
+}
+
+void IngestRecorder::flush() {
+  file.flush();
+}
+
+IngestLogReader::IngestLogReader(std::string const& path) : file(path, std::ios::binary) {
+  char magic[sizeof log_magic];
+  if (!file.read(magic, sizeof magic) || std::memcmp(magic, log_magic, sizeof magic) != 0) {
+    warn("source=IngestLogReader event=InvalidLog path={}", path);
+    file.setstate(std::ios::failbit);
+  }
+}
+
+auto IngestLogReader::good() const -> bool {
+  return file.good();
+}
+
+auto IngestLogReader::next(IngestRecord* record) -> bool {
+  auto size = uint32_t{};
+  if (!file.read(reinterpret_cast<char*>(&size), sizeof size)) return false;
+  buffer.resize(size);
+  if (!file.read(&buffer[0], size)) return false;
+
+  auto offset = std::size_t{0};
+  auto kind = uint8_t{};
+  auto stamp = int64_t{};
+  auto created_at = int64_t{};
+  auto topic_size = uint16_t{};
+  auto content_type = uint8_t{};
+  if (!extract(buffer, &offset, &kind) || !extract(buffer, &offset, &stamp) ||
+      !extract(buffer, &offset, &created_at) || !extract(buffer, &offset, &topic_size) ||
+      buffer.size() - offset < topic_size) {
+    return false;
+  }
+  auto topic = buffer.substr(offset, topic_size);
+  offset += topic_size;
+  if (!extract(buffer, &offset, &content_type)) return false;
+
+  auto time_point = [](int64_t nanoseconds) {
+    return std::chrono::system_clock::time_point{} +
+           std::chrono::duration_cast<std::chrono::system_clock::duration>(
+               std::chrono::nanoseconds(nanoseconds));
+  };
+  record->kind = static_cast<IngestRecord::Kind>(kind);
+  record->received_at = time_point(stamp);
+  record->message = Message{};
+  record->message.set_created_at(time_point(created_at));
+  record->message.set_topic(topic);
+  record->message.set_content_type(static_cast<wire::ContentType>(content_type));
+  record->message.set_body(buffer.substr(offset));
+  return true;
+}
+
+}  // namespace is
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <is/wire/core.hpp>
+#include <string>
+
+namespace is {
+
+// Message received by the ingest stage, as stored on an ingest log
+struct IngestRecord {
+  enum class Kind : uint8_t {
+    // "<source>.FrameTransformations"
+    Transformations = 0,
+    // "BrokerEvents.Consumers"
+    Consumers = 1,
+  };
+
+  Kind kind = Kind::Transformations;
+  std::chrono::system_clock::time_point received_at;
+  // Only the topic, the content type, the creation time and the body are kept
+  Message message;
+};
+
+/* Writes the messages seen by the service to a compact binary log, so the exact same stream can
+  be replayed later without a broker. The log is a header followed by length-prefixed records:
+    header: "ISFTLOG2"
+    record: u32 size of the rest of the record | u8 kind | i64 received_at (ns since epoch) |
+            i64 created_at (ns since epoch) | u16 topic size | topic | u8 content type | body
+  Integers are in the native byte order, logs are meant to be replayed on the same kind of
+  machine that recorded them. */
+class IngestRecorder {
+  std::ofstream file;
+  // Reused to build each record
+  std::string buffer;
+
+ public:
+  explicit IngestRecorder(std::string const& path);
+
+  auto good() const -> bool;
+  void record(IngestRecord::Kind, Message const&, std::chrono::system_clock::time_point);
+  void flush();
+};
+
+// Reads back the records of a log written by IngestRecorder, in the order they were recorded
+class IngestLogReader {
+  std::ifstream file;
+  std::string buffer;
+
+ public:
+  explicit IngestLogReader(std::string const& path);
+
+  // False if the file could not be opened or does not start with the log header
+  auto good() const -> bool;
+  // Returns false at the end of the log, or at the first truncated record
+  auto next(IngestRecord*) -> bool;
+};
+
+}  // namespace is
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace is {
+
+/* Histogram of latencies on exponential buckets, bucket i counting the latencies below 2^i
+  microseconds that did not fit on the previous one, and the last bucket everything else.
+  Recording is a couple of relaxed atomic increments, so any thread can record on it and it can
+  stay enabled in production. */
+class LatencyHistogram {
+ public:
+  // Up to ~8s on the last bounded bucket
+  static constexpr std::size_t n_buckets = 24;
+
+ private:
+  std::array<std::atomic<uint64_t>, n_buckets> buckets;
+  std::atomic<uint64_t> total_us;
+
+ public:
+  LatencyHistogram() : total_us(0) {
+    for (auto& bucket : buckets) { bucket.store(0, std::memory_order_relaxed); }
+  }
+
+  void record(std::chrono::nanoseconds latency) {
+    auto us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    // Number of significant bits, i.e. the first bucket whose bound is above the latency
+    auto bucket = us == 0 ? std::size_t{0} : static_cast<std::size_t>(64 - __builtin_clzll(us));
+    if (bucket >= n_buckets) bucket = n_buckets - 1;
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    total_us.fetch_add(us, std::memory_order_relaxed);
+  }
+
+  auto count(std::size_t bucket) const -> uint64_t {
+    return buckets[bucket].load(std::memory_order_relaxed);
+  }
+  // Sum of all the recorded latencies
+  auto total() const -> std::chrono::microseconds {
+    return std::chrono::microseconds(total_us.load(std::memory_order_relaxed));
+  }
+};
+
+// Records the time from its creation to its destruction, does nothing without a histogram
+class ScopedLatency {
+  LatencyHistogram* histogram;
+  std::chrono::steady_clock::time_point start;
+
+ public:
+  explicit ScopedLatency(LatencyHistogram* h) : histogram(h) {
+    if (histogram) start = std::chrono::steady_clock::now();
+  }
+  // Only records once, needed to initialize it with "auto latency = ScopedLatency{...}"
+  ScopedLatency(ScopedLatency&& other) : histogram(other.histogram), start(other.start) {
+    other.histogram = nullptr;
+  }
+  ScopedLatency(ScopedLatency const&) = delete;
+  ScopedLatency& operator=(ScopedLatency const&) = delete;
+  ~ScopedLatency() {
+    if (histogram) histogram->record(std::chrono::steady_clock::now() - start);
+  }
+};
+
+}  // namespace is
@@ -0,0 +1,42 @@
+#include "path-table.hpp"
+
+namespace is {
+
+auto PathTable::intern(Path const& path) -> PathId {
+  auto it = ids.find(path);
+  if (it != ids.end()) return it->second;
+
+  auto id = PathId{};
+  if (released.empty()) {
+    id = static_cast<PathId>(paths.size());
+    paths.push_back(path);
+  } else {
+    id = released.back();
+    released.pop_back();
+    paths[id] = path;
+  }
+  ids.emplace(path, id);
+  return id;
+}
+
+auto PathTable::find(Path const& path) const -> boost::optional<PathId> {
+  auto it = ids.find(path);
+  if (it == ids.end()) return boost::none;
+  return it->second;
+}
+
+auto PathTable::path(PathId id) const -> Path const& {
+  return paths[id];
+}
+
+void PathTable::release(PathId id) {
+  ids.erase(paths[id]);
+  paths[id].clear();
+  released.push_back(id);
+}
+
+auto PathTable::size() const -> std::size_t {
+  return ids.size();
+}
+
+}  // namespace is
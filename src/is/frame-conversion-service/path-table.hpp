@@ -0,0 +1,34 @@
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "frame-conversion/edge.hpp"
+
+namespace is {
+
+// Small integer that stands for a Path on a PathTable
+using PathId = uint32_t;
+
+/* Interns paths, handing out dense handles so the state of each path can be kept on plain arrays
+  indexed by them. Paths are hashed only when they are interned or looked up, never again while
+  their handles are in use. Released handles are reused by the next paths interned. */
+class PathTable {
+  std::vector<Path> paths;
+  std::unordered_map<Path, PathId, PathHash> ids;
+  std::vector<PathId> released;
+
+ public:
+  // Handle of the path, interning it if it is not on the table yet
+  auto intern(Path const&) -> PathId;
+  auto find(Path const&) const -> boost::optional<PathId>;
+  // Only valid until the next call to intern
+  auto path(PathId) const -> Path const&;
+  void release(PathId);
+
+  // Number of paths on the table
+  auto size() const -> std::size_t;
+};
+
+}  // namespace is
@@ -0,0 +1,44 @@
+#include "point-transformer.hpp"
+#include <is/wire/core/logger.hpp>
+#include "frame-conversion/points.hpp"
+#include "transformation-publisher.hpp"
+
+namespace is {
+
+PointTransformer::PointTransformer(std::shared_ptr<FrameSnapshot const> const* s) : snapshot(s) {}
+
+auto PointTransformer::transform(PointSet* points) const -> bool {
+  if (points->xyz_size() % 3 != 0) {
+    warn("source=PointTransformer event=BadSize frame={} size={}", points->frame(),
+         points->xyz_size());
+    return false;
+  }
+
+  auto current = std::atomic_load(snapshot);
+  auto route = current->find_path(Edge{points->frame(), points->to()});
+  if (!route) {
+    warn("source=PointTransformer event=NoRoute frame={} to={} error='{}'", points->frame(),
+         points->to(), route.error());
+    return false;
+  }
+
+  // A single frame route means the points are already on the requested frame
+  if (route->size() > 1) {
+    auto pose = Pose{};
+    if (points->has_timestamp()) {
+      pose = current->compose(*route, to_timestamp(points->timestamp()));
+    } else {
+      pose = current->compose(*route);
+    }
+    transform_points(pose, points->mutable_xyz()->mutable_data(),
+                     static_cast<std::size_t>(points->xyz_size() / 3));
+  }
+  points->set_frame(points->to());
+  return true;
+}
+
+auto transformed_points_topic(std::string const& source, PointSet const& points) -> std::string {
+  return fmt::format("{}.Points.{}", source, points.to());
+}
+
+}  // namespace is
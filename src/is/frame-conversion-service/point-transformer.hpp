@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "frame-conversion/frame-snapshot.hpp"
+#include "msgs/points.pb.h"
+
+namespace is {
+
+/* Moves the point sets received on "<source>.Points" to the frame they ask for, so consumers do
+  not need to watch the transformation and apply it themselves. Like the TransformationServer,
+  points are transformed with the latest snapshot of the graph. */
+class PointTransformer {
+  // Latest snapshot, replaced by the graph stage through std::atomic_store
+  std::shared_ptr<FrameSnapshot const> const* snapshot;
+
+ public:
+  PointTransformer(std::shared_ptr<FrameSnapshot const> const* snapshot);
+
+  // Transform the points in place, returns false if there is no route between the two frames
+  auto transform(PointSet*) const -> bool;
+};
+
+// Topic the points of the given source are published on once transformed
+auto transformed_points_topic(std::string const& source, PointSet const&) -> std::string;
+
+}  // namespace is
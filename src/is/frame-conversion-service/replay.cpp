@@ -0,0 +1,135 @@
+#include <is/msgs/utils.hpp>
+#include <is/wire/core.hpp>
+#include <is/wire/core/logger.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "calibration-server.hpp"
+#include "conf/options.pb.h"
+#include "consumer-watcher.hpp"
+#include "dependency-tracker.hpp"
+#include "ingest-log.hpp"
+#include "service-options.hpp"
+#include "topic-router.hpp"
+#include "transformation-publisher.hpp"
+
+/* Replays a log recorded by the service (see the record_path option) through the same
+ * ConsumerWatcher, DependencyTracker and TransformationPublisher, without a broker. Publications
+ * are serialized as if they were sent but are only counted. Usage:
+ *   replay.bin <log> [options.json] [--realtime]
+ * The options should be the ones the service was running with. Records are replayed as fast as
+ * possible unless --realtime is given, in which case the original intervals between them are
+ * kept. */
+
+namespace {
+
+struct Arguments {
+  std::string log;
+  std::string options;
+  bool realtime = false;
+};
+
+auto parse_arguments(int argc, char** argv) -> Arguments {
+  auto arguments = Arguments{};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--realtime") == 0) {
+      arguments.realtime = true;
+    } else if (arguments.log.empty()) {
+      arguments.log = argv[i];
+    } else {
+      arguments.options = argv[i];
+    }
+  }
+  if (arguments.log.empty()) {
+    is::critical("Usage: {} <log> [options.json] [--realtime]", argv[0]);
+  }
+  return arguments;
+}
+
+auto percentile(std::vector<std::chrono::nanoseconds> const& sorted, double p) -> double {
+  if (sorted.empty()) return 0.0;
+  auto index = static_cast<std::size_t>(p * (sorted.size() - 1));
+  return std::chrono::duration<double, std::micro>(sorted[index]).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  auto arguments = parse_arguments(argc, argv);
+  auto options = is::FrameConversionServiceOptions{};
+  if (!arguments.options.empty()) is::load(arguments.options, &options);
+
+  auto calibs = is::CalibrationServer{options.calibrations_path(), options.calibrations_cache()};
+  auto conversions = is::create_conversions(options, calibs);
+  auto tracker = is::DependencyTracker{&conversions};
+
+  // Stands in for the publish channel, publications are serialized to account for their cost
+  auto publications = uint64_t{0};
+  auto published_bytes = uint64_t{0};
+  auto publish = [&](is::Publication&& publication) {
+    published_bytes += is::to_message(publication).body().size();
+    ++publications;
+  };
+
+  auto transformation_publisher = is::TransformationPublisher{
+      nullptr, &tracker, &conversions, publish, options.aggregate_topic(),
+      is::dynamic_frames(options), is::change_thresholds(options)};
+
+  auto watcher = is::ConsumerWatcher{nullptr};
+  watcher.on_new_consumer([&](is::Path const& path, std::string const& consumer) {
+    transformation_publisher.update_dependency(path, consumer);
+  });
+  watcher.on_no_consumers(
+      [&](is::Path const& path) { transformation_publisher.remove_dependency(path); });
+
+  auto record = is::IngestRecord{};
+  auto router = is::TopicRouter{};
+  router.on_suffix(".FrameTransformations", [&](is::Message const& message, auto source) {
+    auto tfs = message.unpack<is::vision::FrameTransformations>();
+    if (tfs) {
+      transformation_publisher.run(*tfs, source, record.received_at,
+                                   is::created_at(message, record.received_at));
+    }
+  });
+  router.on_topic("BrokerEvents.Consumers",
+                  [&](is::Message const& message, auto) { watcher.run(message); });
+
+  auto log = is::IngestLogReader{arguments.log};
+  if (!log.good()) is::critical("Unable to read the log \"{}\"", arguments.log);
+
+  // Time spent handling each record, from its decoding to the collection of its publications
+  auto latencies = std::vector<std::chrono::nanoseconds>{};
+  auto first_record = std::chrono::system_clock::time_point{};
+  auto start = std::chrono::steady_clock::now();
+  while (log.next(&record)) {
+    if (latencies.empty()) first_record = record.received_at;
+    if (arguments.realtime) {
+      std::this_thread::sleep_until(start + (record.received_at - first_record));
+    }
+
+    auto handle_start = std::chrono::steady_clock::now();
+    router.route(record.message);
+    // Edges expire on the recorded time, the throttle of the publications on the wall time
+    transformation_publisher.expire(record.received_at);
+    transformation_publisher.flush();
+    latencies.push_back(std::chrono::steady_clock::now() - handle_start);
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+  std::sort(latencies.begin(), latencies.end());
+  is::info(
+      "event=Replay.Done records={} seconds={:.3f} records_per_second={:.1f} "
+      "latency_p50_us={:.1f} latency_p90_us={:.1f} latency_p99_us={:.1f} latency_max_us={:.1f}",
+      latencies.size(), elapsed.count(), latencies.size() / std::max(elapsed.count(), 1e-9),
+      percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+      percentile(latencies, 1.0));
+  is::info(
+      "event=Replay.Graph publications={} published_bytes={} suppressed_updates={} "
+      "dijkstra_runs={} composed_hops={} unresolved_retries={} tracked_paths={} "
+      "unresolved_paths={}",
+      publications, published_bytes, transformation_publisher.suppressed(),
+      conversions.dijkstra_runs(), conversions.composed_hops(), tracker.unresolved_retries(),
+      tracker.resolved_size(), tracker.unresolved_size());
+}
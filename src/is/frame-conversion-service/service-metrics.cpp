@@ -0,0 +1,44 @@
+#include "service-metrics.hpp"
+#include <chrono>
+
+namespace is {
+
+static void fill(LatencyHistogram const& histogram, HistogramMetric* metric) {
+  auto count = uint64_t{0};
+  for (std::size_t bucket = 0; bucket < LatencyHistogram::n_buckets; ++bucket) {
+    auto n = histogram.count(bucket);
+    metric->add_buckets(n);
+    count += n;
+  }
+  metric->set_count(count);
+  metric->set_sum_ms(histogram.total().count() / 1000.0);
+}
+
+auto to_message(ServiceMetrics const& metrics) -> FrameConversionMetrics {
+  auto message = FrameConversionMetrics{};
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now);
+  message.mutable_timestamp()->set_seconds(seconds.count());
+  message.mutable_timestamp()->set_nanos(static_cast<int32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - seconds).count()));
+
+  fill(metrics.decode, message.mutable_decode());
+  fill(metrics.graph_update, message.mutable_graph_update());
+  fill(metrics.dependency_recompute, message.mutable_dependency_recompute());
+  fill(metrics.publish, message.mutable_publish());
+
+  message.set_dijkstra_runs(metrics.dijkstra_runs.load(std::memory_order_relaxed));
+  message.set_composed_hops(metrics.composed_hops.load(std::memory_order_relaxed));
+  message.set_unresolved_retries(metrics.unresolved_retries.load(std::memory_order_relaxed));
+  message.set_publications(metrics.publications.load(std::memory_order_relaxed));
+  message.set_suppressed_updates(metrics.suppressed_updates.load(std::memory_order_relaxed));
+
+  message.set_frames(metrics.frames.load(std::memory_order_relaxed));
+  message.set_edges(metrics.edges.load(std::memory_order_relaxed));
+  message.set_tracked_paths(metrics.tracked_paths.load(std::memory_order_relaxed));
+  message.set_unresolved_paths(metrics.unresolved_paths.load(std::memory_order_relaxed));
+  message.set_pending_topics(metrics.pending_topics.load(std::memory_order_relaxed));
+  return message;
+}
+
+}  // namespace is
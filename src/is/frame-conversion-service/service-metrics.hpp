@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "latency-histogram.hpp"
+#include "msgs/metrics.pb.h"
+
+namespace is {
+
+/* Metrics of the whole service. Each stage records on its own histograms and counters, the
+  values owned by the graph stage (which are not thread safe there) are copied here after every
+  update. Any thread can then report them. */
+struct ServiceMetrics {
+  LatencyHistogram decode;
+  LatencyHistogram graph_update;
+  LatencyHistogram dependency_recompute;
+  LatencyHistogram publish;
+
+  std::atomic<uint64_t> dijkstra_runs{0};
+  std::atomic<uint64_t> composed_hops{0};
+  std::atomic<uint64_t> unresolved_retries{0};
+  std::atomic<uint64_t> publications{0};
+  std::atomic<uint64_t> suppressed_updates{0};
+
+  std::atomic<uint64_t> frames{0};
+  std::atomic<uint64_t> edges{0};
+  std::atomic<uint64_t> tracked_paths{0};
+  std::atomic<uint64_t> unresolved_paths{0};
+  std::atomic<uint64_t> pending_topics{0};
+};
+
+auto to_message(ServiceMetrics const&) -> FrameConversionMetrics;
+
+}  // namespace is
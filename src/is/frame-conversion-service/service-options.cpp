@@ -0,0 +1,38 @@
+#include "service-options.hpp"
+#include <is/wire/core/logger.hpp>
+
+namespace is {
+
+auto create_conversions(FrameConversionServiceOptions const& options,
+                        CalibrationServer const& calibs) -> FrameConversion {
+  auto conversions = FrameConversion{options.rigid_transformations()
+                                         ? FrameConversion::Mode::Rigid
+                                         : FrameConversion::Mode::General};
+  for (auto const& root : options.shortest_path_roots()) { conversions.keep_tree(root); }
+  conversions.set_history_depth(options.history_depth());
+  for (auto const& error : conversions.update_transformations(calibs.extrinsics())) {
+    warn("source=CalibrationServer event=InvalidExtrinsic edge={} error='{}'", error.first,
+         error.second);
+  }
+  return conversions;
+}
+
+auto dynamic_frames(FrameConversionServiceOptions const& options) -> DynamicFrames {
+  auto dynamic = DynamicFrames{};
+  if (options.has_dynamic_frames()) {
+    dynamic.first = options.dynamic_frames().first();
+    dynamic.last = options.dynamic_frames().last();
+  }
+  dynamic.ttl = std::chrono::milliseconds(options.dynamic_ttl_ms());
+  return dynamic;
+}
+
+auto change_thresholds(FrameConversionServiceOptions const& options) -> ChangeThresholds {
+  auto thresholds = ChangeThresholds{};
+  thresholds.rotation = options.rotation_threshold();
+  thresholds.translation = options.translation_threshold();
+  thresholds.keepalive = std::chrono::milliseconds(options.keepalive_ms());
+  return thresholds;
+}
+
+}  // namespace is
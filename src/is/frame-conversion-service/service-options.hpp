@@ -0,0 +1,20 @@
+#pragma once
+
+#include "calibration-server.hpp"
+#include "conf/options.pb.h"
+#include "frame-conversion/frame-conversion.hpp"
+#include "transformation-publisher.hpp"
+
+namespace is {
+
+// Parts of the service set up from its options, shared by the service and the replay tool
+
+// Graph solver with the mode and trees given by the options, holding the calibration extrinsics
+auto create_conversions(FrameConversionServiceOptions const&, CalibrationServer const&)
+    -> FrameConversion;
+
+auto dynamic_frames(FrameConversionServiceOptions const&) -> DynamicFrames;
+
+auto change_thresholds(FrameConversionServiceOptions const&) -> ChangeThresholds;
+
+}  // namespace is
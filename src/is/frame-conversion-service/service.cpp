@@ -1,15 +1,56 @@
 #include <zipkin/opentracing.h>
-#include <boost/algorithm/string.hpp>
 #include <is/msgs/utils.hpp>
 #include <is/wire/core.hpp>
 #include <is/wire/rpc.hpp>
 #include <is/wire/rpc/log-interceptor.hpp>
+#include <regex>
+#include <thread>
 #include "calibration-server.hpp"
 #include "conf/options.pb.h"
 #include "consumer-watcher.hpp"
 #include "dependency-tracker.hpp"
+#include "directory-watcher.hpp"
 #include "frame-conversion/frame-conversion.hpp"
+#include "frame-conversion/frame-snapshot.hpp"
+#include "ingest-log.hpp"
+#include "point-transformer.hpp"
+#include "service-metrics.hpp"
+#include "service-options.hpp"
+#include "spsc-queue.hpp"
+#include "topic-router.hpp"
 #include "transformation-publisher.hpp"
+#include "transformation-server.hpp"
+
+// Capacity of the queues between the stages of the service
+static constexpr auto queue_capacity = std::size_t{4096};
+// Interval between reports of the queues state and the service metrics
+static constexpr auto report_interval = std::chrono::seconds(10);
+// Longest time the graph stage waits for new poses before checking for reloaded calibrations
+static constexpr auto reload_check_interval = std::chrono::milliseconds(200);
+
+// Work handed from the ingest stage to the graph stage
+struct GraphEvent {
+  enum class Type { Transformations, NewConsumer, NoConsumers };
+  Type type = Type::Transformations;
+  // Source of the transformations, e.g. "ArUco.1" for "ArUco.1.FrameTransformations"
+  std::string source;
+  is::vision::FrameTransformations tfs;
+  // Time the transformations were received, used to refresh the leases of dynamic frames
+  std::chrono::system_clock::time_point received_at;
+  // Time the sender created the message, used as the time of the poses on the histories
+  std::chrono::system_clock::time_point created_at;
+  // Path requested by the consumer
+  is::Path path;
+  std::string consumer;
+  std::unique_ptr<opentracing::Span> span;
+};
+
+// Point set handed from the ingest stage to the points stage, decoded by the latter
+struct PointsEvent {
+  is::Message message;
+  // Source of the points, e.g. "Camera.1" for "Camera.1.Points"
+  std::string source;
+};
 
 auto load_configuration(int argc, char** argv) -> is::FrameConversionServiceOptions {
   auto filename = (argc == 2) ? argv[1] : "options.json";
@@ -42,58 +83,238 @@ int main(int argc, char* argv[]) {
 
   auto subscription = is::Subscription{channel};
 
-  auto server = is::ServiceProvider{channel};
-  auto logs = is::LogInterceptor{};
-  server.add_interceptor(logs);
+  auto calibs = is::CalibrationServer{options.calibrations_path(), options.calibrations_cache()};
+  auto conversions = is::create_conversions(options, calibs);
 
-  auto calibs = is::CalibrationServer{options.calibrations_path()};
-  server.delegate<is::vision::GetCalibrationRequest, is::vision::GetCalibrationReply>(
-      service + ".GetCalibration", [&](auto* ctx, auto const& request, auto* reply) {
-        return calibs.get_calibration(ctx, request, reply);
-      });
-
-  auto conversions = is::FrameConversion{};
-  for (auto const& calibration : calibs.calibrations()) {
-    for (auto const& transformation : calibration.second.extrinsic()) {
-      conversions.update_transformation(transformation);
-    }
-  }
+  // Always collected, reported along with the queues state
+  auto metrics = is::ServiceMetrics{};
 
   auto tracker = is::DependencyTracker{&conversions};
+  tracker.measure_recompute(&metrics.dependency_recompute);
+
+  /* Only the graph stage touches conversions, after every update it publishes an immutable
+   * snapshot that other threads can query at any time. Always accessed through
+   * std::atomic_load/std::atomic_store. */
+  auto snapshot = is::FrameSnapshot::create(conversions);
+
+  auto transformation_server = is::TransformationServer{&snapshot};
+  auto point_transformer = is::PointTransformer{&snapshot};
+
+  /* The service runs as a pipeline of stages connected by bounded queues:
+   *  - ingest (this thread): consumes and decodes messages and watches consumers;
+   *  - rpc: serves the RPCs from the latest snapshot, consuming the requests on its own channel;
+   *  - graph: owns the FrameConversion and the DependencyTracker, applying the updates to them;
+   *  - publish: serializes and sends the resulting transformations on its own channel;
+   *  - points (if enabled): decodes, transforms and sends the point sets on its own channel.
+   * A full queue blocks the stage that feeds it, so bursts on the output do not grow memory and
+   * do not delay the ingestion of poses more than the queue depth. Point sets are the exception,
+   * they are dropped while the points stage is behind so they never hold the poses back. */
+  is::SpscQueue<GraphEvent> graph_queue{queue_capacity};
+  is::SpscQueue<is::Publication> publish_queue{queue_capacity};
+  is::SpscQueue<PointsEvent> points_queue{queue_capacity};
+  // Point sets dropped because the points queue was full, only touched by the ingest stage
+  auto dropped_points = uint64_t{0};
+  // Changes on the calibrations directory, from the reload stage to the graph stage
+  is::SpscQueue<is::CalibrationDiff> reload_queue{16};
 
   // Watch consumers of this service and updates the dependency tracker.
   auto watcher = is::ConsumerWatcher{&subscription};
 
-  // Make Path from topic string.
-  auto create_path = [](std::string const& from) {
-    std::vector<std::string> ids;
-    boost::split(ids, from, boost::is_any_of("."));
-    is::Path path;
-    path.reserve(ids.size() - 1);
-    std::transform(ids.begin() + 1, ids.end(), std::back_inserter(path),
-                   [](std::string const& id) { return std::stoll(id); });
-    return path;
+  // The watcher only reports topics that are valid paths
+  watcher.on_new_consumer([&](is::Path const& path, std::string const& consumer) {
+    auto event = GraphEvent{};
+    event.type = GraphEvent::Type::NewConsumer;
+    event.consumer = consumer;
+    event.path = path;
+    graph_queue.push(std::move(event));
+  });
+
+  watcher.on_no_consumers([&](is::Path const& path) {
+    auto event = GraphEvent{};
+    event.type = GraphEvent::Type::NoConsumers;
+    event.path = path;
+    graph_queue.push(std::move(event));
+  });
+
+  auto transformation_publisher = is::TransformationPublisher{
+      &subscription, &tracker, &conversions,
+      [&](is::Publication&& publication) { publish_queue.push(std::move(publication)); },
+      options.aggregate_topic(), is::dynamic_frames(options), is::change_thresholds(options)};
+
+  // Stream of messages driving the graph stage, recorded to be replayed offline if requested
+  auto recorder = std::unique_ptr<is::IngestRecorder>{};
+  if (!options.record_path().empty()) {
+    recorder.reset(new is::IngestRecorder{options.record_path()});
+  }
+
+  // Routes are set up once, the ingest loop only dispatches on them
+  auto router = is::TopicRouter{};
+  router.on_suffix(".FrameTransformations", [&](is::Message const& message, auto source) {
+    auto received_at = std::chrono::system_clock::now();
+    if (recorder) recorder->record(is::IngestRecord::Kind::Transformations, message, received_at);
+
+    auto maybe_ctx = message.extract_tracing(tracer);
+    auto event = GraphEvent{};
+    event.span = maybe_ctx
+                     ? tracer->StartSpan("UpdateTFs", {opentracing::ChildOf(maybe_ctx->get())})
+                     : tracer->StartSpan("UpdateTFs");
+
+    auto tfs = [&] {
+      auto latency = is::ScopedLatency{&metrics.decode};
+      return message.unpack<is::vision::FrameTransformations>();
+    }();
+    if (!tfs) {
+      is::warn("event=Publisher.BadSchema");
+      return;
+    }
+    event.type = GraphEvent::Type::Transformations;
+    event.source = source.to_string();
+    event.tfs = std::move(*tfs);
+    event.received_at = received_at;
+    event.created_at = is::created_at(message, received_at);
+    graph_queue.push(std::move(event));
+  });
+  router.on_topic("BrokerEvents.Consumers", [&](is::Message const& message, auto) {
+    if (recorder) {
+      recorder->record(is::IngestRecord::Kind::Consumers, message,
+                       std::chrono::system_clock::now());
+    }
+    watcher.run(message);
+  });
+  if (options.transform_points()) {
+    subscription.subscribe("#.Points");
+    router.on_suffix(".Points", [&](is::Message const& message, auto source) {
+      if (!points_queue.try_push(PointsEvent{message, source.to_string()})) ++dropped_points;
+    });
+  }
+
+  // Values that are only safe to read from the graph stage, copied to the shared metrics
+  auto record_graph_metrics = [&] {
+    auto relaxed = std::memory_order_relaxed;
+    metrics.dijkstra_runs.store(conversions.dijkstra_runs(), relaxed);
+    metrics.composed_hops.store(conversions.composed_hops(), relaxed);
+    metrics.unresolved_retries.store(tracker.unresolved_retries(), relaxed);
+    metrics.frames.store(conversions.num_frames(), relaxed);
+    metrics.edges.store(conversions.transformations().size(), relaxed);
+    metrics.tracked_paths.store(tracker.resolved_size(), relaxed);
+    metrics.unresolved_paths.store(tracker.unresolved_size(), relaxed);
+    metrics.pending_topics.store(transformation_publisher.pending(), relaxed);
+    metrics.suppressed_updates.store(transformation_publisher.suppressed(), relaxed);
   };
 
-  watcher.on_new_consumer([&](std::string const& topic, std::string const& consumer) {
-    auto path = create_path(topic);
-    auto maybe_transformation = tracker.update_dependency(path);
-    if (maybe_transformation) { channel.publish(consumer, is::Message{*maybe_transformation}); }
+  auto graph_stage = std::thread([&] {
+    auto event = GraphEvent{};
+    auto diff = is::CalibrationDiff{};
+    auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(1);
+    for (;;) {
+      while (reload_queue.try_pop(&diff)) {
+        transformation_publisher.run(diff);
+        std::atomic_store(&snapshot, is::FrameSnapshot::create(conversions, snapshot));
+      }
+
+      auto wait = std::min(deadline, std::chrono::system_clock::now() + reload_check_interval);
+      if (graph_queue.pop_until(&event, wait)) {
+        if (event.type == GraphEvent::Type::Transformations) {
+          auto latency = is::ScopedLatency{&metrics.graph_update};
+          transformation_publisher.run(event.tfs, event.source, event.received_at,
+                                       event.created_at);
+        } else if (event.type == GraphEvent::Type::NewConsumer) {
+          transformation_publisher.update_dependency(event.path, event.consumer);
+        } else {
+          transformation_publisher.remove_dependency(event.path);
+        }
+        // Finish the span as soon as the update is done
+        event.span.reset();
+      }
+      // Checked at least every reload_check_interval, which bounds how late an edge expires
+      transformation_publisher.expire(std::chrono::system_clock::now());
+      // Reuses the current snapshot if nothing changed
+      std::atomic_store(&snapshot, is::FrameSnapshot::create(conversions, snapshot));
+      record_graph_metrics();
+      deadline = transformation_publisher.flush();
+    }
+  });
+
+  // Recalibrations are applied without restarting, only the affected paths are recomputed
+  auto reload_stage = std::thread([&] {
+    is::DirectoryWatcher directory{options.calibrations_path()};
+    while (directory.wait()) {
+      auto diff = calibs.reload();
+      if (!diff.empty()) reload_queue.push(std::move(diff));
+    }
+    is::warn("source=CalibrationServer event=ReloadDisabled path={}", options.calibrations_path());
   });
 
-  watcher.on_no_consumers(
-      [&](std::string const& topic) { tracker.remove_dependency(create_path(topic)); });
+  // Point sets are served from the snapshot like the RPCs, without going through the graph stage
+  auto points_stage = std::thread([&] {
+    if (!options.transform_points()) return;
+    auto points_channel = is::Channel{options.broker_uri()};
+    points_channel.set_tracer(tracer);
+    auto event = PointsEvent{};
+    for (;;) {
+      points_queue.pop(&event);
+      auto points = event.message.unpack<is::PointSet>();
+      if (!points) {
+        is::warn("event=PointTransformer.BadSchema");
+        continue;
+      }
+      if (point_transformer.transform(&*points)) {
+        points_channel.publish(is::transformed_points_topic(event.source, *points),
+                               is::Message{*points});
+      }
+    }
+  });
 
-  auto transformation_publisher =
-      is::TransformationPublisher{channel, &subscription, tracer, &tracker, &conversions};
+  // Requests are consumed on another channel, so a slow batch query never delays the ingestion
+  auto rpc_stage = std::thread([&] {
+    auto rpc_channel = is::Channel{options.broker_uri()};
+    rpc_channel.set_tracer(tracer);
+    auto server = is::ServiceProvider{rpc_channel};
+    auto logs = is::LogInterceptor{};
+    server.add_interceptor(logs);
+    server.delegate<is::vision::GetCalibrationRequest, is::vision::GetCalibrationReply>(
+        service + ".GetCalibration", [&](auto* ctx, auto const& request, auto* reply) {
+          return calibs.get_calibration(ctx, request, reply);
+        });
+    server.delegate<is::GetTransformationsRequest, is::GetTransformationsReply>(
+        service + ".GetTransformations", [&](auto* ctx, auto const& request, auto* reply) {
+          return transformation_server.get_transformations(ctx, request, reply);
+        });
+    server.run();
+  });
 
-  auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(1);
+  auto publish_stage = std::thread([&] {
+    // AMQP channels can not be shared between threads
+    auto publish_channel = is::Channel{options.broker_uri()};
+    publish_channel.set_tracer(tracer);
+    auto publication = is::Publication{};
+    for (;;) {
+      // Parks the thread while there is nothing to publish
+      publish_queue.pop(&publication);
+      {
+        auto latency = is::ScopedLatency{&metrics.publish};
+        publish_channel.publish(publication.topic, is::to_message(publication));
+      }
+      metrics.publications.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+
+  auto report_deadline = std::chrono::system_clock::now() + report_interval;
   for (;;) {
-    auto maybe_message = channel.consume_until(deadline);
-    deadline = transformation_publisher.run(maybe_message);
-    if (maybe_message) {
-      watcher.run(*maybe_message);
-      server.serve(*maybe_message);
+    auto maybe_message = channel.consume_until(report_deadline);
+    if (maybe_message) { router.route(*maybe_message); }
+
+    if (std::chrono::system_clock::now() >= report_deadline) {
+      is::info(
+          "event=Pipeline.Queues graph_depth={} graph_max_depth={} graph_full={} "
+          "publish_depth={} publish_max_depth={} publish_full={} points_depth={} "
+          "points_max_depth={} points_dropped={}",
+          graph_queue.depth(), graph_queue.max_depth(), graph_queue.full_count(),
+          publish_queue.depth(), publish_queue.max_depth(), publish_queue.full_count(),
+          points_queue.depth(), points_queue.max_depth(), dropped_points);
+      channel.publish(service + ".Metrics", is::Message{is::to_message(metrics)});
+      if (recorder) recorder->flush();
+      report_deadline += report_interval;
     }
   }
 }
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace is {
+
+/* Waits in increasing steps, busy spinning first and then yielding the cpu, so short waits have
+  low latency. Once it is exhausted the caller is expected to block instead of polling. */
+class Backoff {
+  unsigned steps = 0;
+
+ public:
+  // Returns false, without waiting, once the caller should block
+  auto wait() -> bool {
+    if (steps >= 128) return false;
+    if (steps >= 64) std::this_thread::yield();
+    ++steps;
+    return true;
+  }
+};
+
+/* Bounded lock-free queue between exactly one producer thread and one consumer thread, used to
+  connect the stages of the service. The producer blocks while the queue is full, so a slow stage
+  slows down the ones before it instead of letting memory grow without bounds.
+  Either side spins for a short while and then parks on a condition variable, raising a flag so
+  the other side knows it has to notify it. While nobody is parked, a push or a pop only costs a
+  fence and a load of that flag over the lock-free path. */
+template <typename T>
+class SpscQueue {
+  using TimePoint = std::chrono::system_clock::time_point;
+
+  std::vector<T> slots;
+  std::size_t mask;
+  // Next slot to be read, only written by the consumer
+  alignas(64) std::atomic<std::size_t> head;
+  // Next slot to be written, only written by the producer
+  alignas(64) std::atomic<std::size_t> tail;
+  // Metrics, the depth high-water mark and the number of pushes that found the queue full
+  alignas(64) std::atomic<std::size_t> high_water;
+  std::atomic<uint64_t> full;
+  // Set while the consumer waits for a value and while the producer waits for room
+  alignas(64) std::atomic<bool> consumer_parked;
+  std::atomic<bool> producer_parked;
+  std::mutex parking;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+
+  // Lock-free attempts, that do not wake up the other side. The value is only moved on success.
+  auto put(T&& value) -> bool {
+    auto t = tail.load(std::memory_order_relaxed);
+    auto depth = t - head.load(std::memory_order_acquire);
+    if (depth == slots.size()) return false;
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    if (depth + 1 > high_water.load(std::memory_order_relaxed)) {
+      high_water.store(depth + 1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  auto take(T* value) -> bool {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    *value = std::move(slots[h & mask]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* Block until ready() or until the deadline, if any, returning the last result of ready(). The
+    fence after raising the flag pairs with the one on wake(): either the last check of ready()
+    sees the change made by the other side or the other side sees the flag. */
+  template <typename F>
+  auto park(std::atomic<bool>& parked, std::condition_variable& condition, F const& ready,
+            TimePoint const* deadline) -> bool {
+    std::unique_lock<std::mutex> lock{parking};
+    parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto done = true;
+    if (deadline) {
+      done = condition.wait_until(lock, *deadline, ready);
+    } else {
+      condition.wait(lock, ready);
+    }
+    parked.store(false, std::memory_order_relaxed);
+    return done;
+  }
+
+  // Notify the other side if it is parked. Taking the lock ensures it is already waiting.
+  void wake(std::atomic<bool>& parked, std::condition_variable& condition) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!parked.load(std::memory_order_relaxed)) return;
+    { std::lock_guard<std::mutex> lock{parking}; }
+    condition.notify_one();
+  }
+
+  // Wait for the value to be popped, or until the deadline if any
+  auto wait_pop(T* value, TimePoint const* deadline) -> bool {
+    auto ready = [this, value] { return take(value); };
+    for (auto backoff = Backoff{}; !ready();) {
+      if (deadline && std::chrono::system_clock::now() >= *deadline) return false;
+      if (backoff.wait()) continue;
+      if (!park(consumer_parked, not_empty, ready, deadline)) return false;
+      break;
+    }
+    wake(producer_parked, not_full);
+    return true;
+  }
+
+ public:
+  // The capacity is rounded up to a power of two
+  explicit SpscQueue(std::size_t capacity)
+      : mask(1),
+        head(0),
+        tail(0),
+        high_water(0),
+        full(0),
+        consumer_parked(false),
+        producer_parked(false) {
+    while (mask < capacity) { mask *= 2; }
+    slots.resize(mask);
+    mask -= 1;
+  }
+
+  SpscQueue(SpscQueue const&) = delete;
+  SpscQueue& operator=(SpscQueue const&) = delete;
+
+  auto try_push(T&& value) -> bool {
+    if (!put(std::move(value))) return false;
+    wake(consumer_parked, not_empty);
+    return true;
+  }
+
+  // Blocks until there is room for the value
+  void push(T&& value) {
+    auto ready = [this, &value] { return put(std::move(value)); };
+    if (!ready()) {
+      full.fetch_add(1, std::memory_order_relaxed);
+      for (auto backoff = Backoff{}; !ready();) {
+        if (backoff.wait()) continue;
+        park(producer_parked, not_full, ready, nullptr);
+        break;
+      }
+    }
+    wake(consumer_parked, not_empty);
+  }
+
+  auto try_pop(T* value) -> bool {
+    if (!take(value)) return false;
+    wake(producer_parked, not_full);
+    return true;
+  }
+
+  // Blocks until a value is available
+  void pop(T* value) { wait_pop(value, nullptr); }
+
+  // Blocks until a value is available or the deadline is reached, returning false on the latter
+  auto pop_until(T* value, TimePoint const& deadline) -> bool { return wait_pop(value, &deadline); }
+
+  auto capacity() const -> std::size_t { return slots.size(); }
+  // Number of values waiting on the queue, exact only when called from one of its two threads
+  auto depth() const -> std::size_t {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+  }
+  auto max_depth() const -> std::size_t { return high_water.load(std::memory_order_relaxed); }
+  auto full_count() const -> uint64_t { return full.load(std::memory_order_relaxed); }
+};
+
+}  // namespace is
@@ -0,0 +1,105 @@
+#include "topic-router.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace is {
+
+static auto const path_prefix = boost::string_view{"FrameTransformation."};
+
+TopicTokens::TopicTokens(boost::string_view topic) : rest(topic), done(false) {}
+
+auto TopicTokens::next(boost::string_view* token) -> bool {
+  if (done) return false;
+  auto dot = rest.find('.');
+  if (dot == boost::string_view::npos) {
+    *token = rest;
+    done = true;
+  } else {
+    *token = rest.substr(0, dot);
+    rest.remove_prefix(dot + 1);
+  }
+  return true;
+}
+
+auto parse_id(boost::string_view token, int64_t* id) -> bool {
+  if (token.empty()) return false;
+  auto value = int64_t{0};
+  for (auto c : token) {
+    if (c < '0' || c > '9') return false;
+    auto digit = c - '0';
+    if (value > (std::numeric_limits<int64_t>::max() - digit) / 10) return false;
+    value = 10 * value + digit;
+  }
+  *id = value;
+  return true;
+}
+
+auto is_path_topic(boost::string_view topic) -> bool {
+  if (!topic.starts_with(path_prefix)) return false;
+  topic.remove_prefix(path_prefix.size());
+
+  auto tokens = TopicTokens{topic};
+  auto token = boost::string_view{};
+  auto n_ids = 0;
+  for (auto id = int64_t{}; tokens.next(&token); ++n_ids) {
+    if (!parse_id(token, &id)) return false;
+  }
+  return n_ids >= 2;
+}
+
+auto parse_path(boost::string_view topic) -> boost::optional<Path> {
+  if (!is_path_topic(topic)) return boost::none;
+  topic.remove_prefix(path_prefix.size());
+
+  auto path = Path{};
+  path.reserve(std::count(topic.begin(), topic.end(), '.') + 1);
+  auto tokens = TopicTokens{topic};
+  auto token = boost::string_view{};
+  for (auto id = int64_t{}; tokens.next(&token);) {
+    parse_id(token, &id);
+    path.push_back(id);
+  }
+  return path;
+}
+
+auto path_topic(Path const& path) -> std::string {
+  auto topic = path_prefix.to_string();
+  for (auto it = path.begin(); it != path.end(); ++it) {
+    if (it != path.begin()) topic += '.';
+    topic += std::to_string(*it);
+  }
+  return topic;
+}
+
+void TopicRouter::on_topic(std::string const& topic, Handler const& handler) {
+  routes.push_back(Route{topic, "", true, handler});
+}
+
+void TopicRouter::on_suffix(std::string const& suffix, Handler const& handler) {
+  routes.push_back(Route{"", suffix, false, handler});
+}
+
+void TopicRouter::on_prefix(std::string const& prefix, Handler const& handler) {
+  routes.push_back(Route{prefix, "", false, handler});
+}
+
+void TopicRouter::otherwise(std::function<void(Message const&)> const& handler) {
+  fallback = handler;
+}
+
+auto TopicRouter::route(Message const& message) const -> bool {
+  auto const& topic = message.topic();
+  auto view = boost::string_view{topic};
+  for (auto const& route : routes) {
+    auto length = route.prefix.size() + route.suffix.size();
+    auto matches = route.exact ? view.size() == length : view.size() > length;
+    if (!matches || !view.starts_with(route.prefix) || !view.ends_with(route.suffix)) continue;
+
+    route.handler(message, view.substr(route.prefix.size(), view.size() - length));
+    return true;
+  }
+  if (fallback) fallback(message);
+  return false;
+}
+
+}  // namespace is
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+#include <functional>
+#include <is/wire/core.hpp>
+#include <string>
+#include <vector>
+#include "frame-conversion/frame-conversion.hpp"
+
+namespace is {
+
+/* Splits a topic into its dot separated tokens. Tokens are views into the topic, so iterating
+  over them does not allocate. */
+class TopicTokens {
+  boost::string_view rest;
+  bool done;
+
+ public:
+  explicit TopicTokens(boost::string_view topic);
+  // Stores the next token and returns true, or returns false when there are no tokens left
+  auto next(boost::string_view* token) -> bool;
+};
+
+// Parse a non-negative frame id, the token must contain only digits
+auto parse_id(boost::string_view token, int64_t* id) -> bool;
+// Parse a "FrameTransformation.<id>.<id>[.<id>...]" topic into the path it requests
+auto parse_path(boost::string_view topic) -> boost::optional<Path>;
+// Same as parse_path but only checks the topic, without building the path
+auto is_path_topic(boost::string_view topic) -> bool;
+// Inverse of parse_path
+auto path_topic(Path const& path) -> std::string;
+
+/* Dispatches messages to the handler registered for their topic. Routes are matched in the
+  order they were added and only the first match is called. */
+class TopicRouter {
+ public:
+  // (message, part of the topic in between the prefix and the suffix) -> void
+  using Handler = std::function<void(Message const&, boost::string_view)>;
+
+ private:
+  struct Route {
+    std::string prefix;
+    std::string suffix;
+    // Requires the topic to be exactly prefix + suffix
+    bool exact;
+    Handler handler;
+  };
+  std::vector<Route> routes;
+  std::function<void(Message const&)> fallback;
+
+ public:
+  // Topics equal to the given one
+  void on_topic(std::string const& topic, Handler const& handler);
+  // Topics with a non empty part before the given suffix, e.g. "<source>.FrameTransformations"
+  void on_suffix(std::string const& suffix, Handler const& handler);
+  // Topics with a non empty part after the given prefix
+  void on_prefix(std::string const& prefix, Handler const& handler);
+  // Called for messages that match no route
+  void otherwise(std::function<void(Message const&)> const& handler);
+
+  // Returns true if a route matched the message topic
+  auto route(Message const&) const -> bool;
+};
+
+}  // namespace is
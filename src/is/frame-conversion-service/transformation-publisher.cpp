@@ -1,96 +1,211 @@
 #include "transformation-publisher.hpp"
-#include <boost/algorithm/string.hpp>
-#include <boost/algorithm/string/compare.hpp>
-#include <boost/range/adaptor/transformed.hpp>
-#include <regex>
+#include "topic-router.hpp"
 
 namespace is {
 
-auto TransformationPublisher::create_topic(is::Path const& path) -> std::string {
-  auto joined = boost::algorithm::join(
-      path | boost::adaptors::transformed([](int64_t i) { return std::to_string(i); }), ".");
-  return "FrameTransformation." + joined;
+static constexpr auto throttle_interval = std::chrono::milliseconds(100);
+
+// "FrameTransformation.<from>[.<hints...>].<to>" -> "<aggregate>[.<hints...>]"
+static auto batch_topic(std::string const& aggregate, std::string const& path_topic)
+    -> std::string {
+  auto from = path_topic.find('.');
+  auto hints = path_topic.find('.', from + 1);
+  auto to = path_topic.rfind('.');
+  return aggregate + path_topic.substr(hints, to - hints);
 }
 
-static constexpr auto throttle_interval = std::chrono::milliseconds(100);
+namespace {
+struct ToMessage : boost::static_visitor<Message> {
+  template <typename T>
+  auto operator()(T const& payload) const -> Message {
+    return Message{payload};
+  }
+};
+}  // namespace
 
-TransformationPublisher::TransformationPublisher(Channel const& ch, Subscription* sub,
-                                                 std::shared_ptr<opentracing::Tracer> const& trace,
-                                                 DependencyTracker* track, FrameConversion* conv)
-    : channel(ch),
-      tracer(trace),
-      tracker(track),
+auto to_message(Publication const& publication) -> Message {
+  return boost::apply_visitor(ToMessage{}, publication.payload);
+}
+
+auto created_at(Message const& message, FrameConversion::Timestamp received_at)
+    -> FrameConversion::Timestamp {
+  // Unset on messages that were not created by is-wire, e.g. from plain AMQP clients
+  auto created = message.created_at();
+  return created.time_since_epoch().count() > 0 ? created : received_at;
+}
+
+auto to_timestamp(google::protobuf::Timestamp const& timestamp) -> FrameConversion::Timestamp {
+  return FrameConversion::Timestamp{} +
+         std::chrono::duration_cast<std::chrono::system_clock::duration>(
+             std::chrono::seconds(timestamp.seconds()) +
+             std::chrono::nanoseconds(timestamp.nanos()));
+}
+
+TransformationPublisher::TransformationPublisher(Subscription* sub, DependencyTracker* track,
+                                                 FrameConversion* conv,
+                                                 std::function<void(Publication&&)> const& pub,
+                                                 std::string const& aggregate,
+                                                 DynamicFrames const& dyn,
+                                                 ChangeThresholds const& thr)
+    : tracker(track),
       conversions(conv),
+      aggregate_topic(aggregate),
+      publish(pub),
+      dynamic(dyn),
+      thresholds(thr),
+      n_suppressed(0),
       publish_deadline(std::chrono::system_clock::now() + throttle_interval) {
-  sub->subscribe("#.FrameTransformations");
+  if (sub) sub->subscribe("#.FrameTransformations");
 }
 
 auto TransformationPublisher::next_deadline() -> std::chrono::system_clock::time_point {
-  return transformations.empty() ? std::chrono::system_clock::now() + std::chrono::seconds(10)
-                                 : publish_deadline;
+  // Published paths are checked for an expired keepalive on every throttle interval
+  auto waiting =
+      !transformations.empty() || (!published.empty() && thresholds.keepalive.count() > 0);
+  return waiting ? publish_deadline : std::chrono::system_clock::now() + std::chrono::seconds(10);
 }
 
-auto TransformationPublisher::run(boost::optional<Message> const& msg)
-    -> std::chrono::system_clock::time_point {
-  if (msg) {
-    if (!std::regex_match(msg->topic(), std::regex(".+\\.FrameTransformations"))) {
-      return next_deadline();
-    }
+auto TransformationPublisher::tracks_published() const -> bool {
+  return thresholds.enabled() || thresholds.keepalive.count() > 0;
+}
 
-    auto maybe_ctx = msg->extract_tracing(tracer);
-    auto root = maybe_ctx ? tracer->StartSpan("UpdateTFs", {opentracing::ChildOf(maybe_ctx->get())})
-                          : tracer->StartSpan("UpdateTFs");
+void TransformationPublisher::run(vision::FrameTransformations const& tfs,
+                                  boost::string_view source,
+                                  FrameConversion::Timestamp received_at,
+                                  FrameConversion::Timestamp created_at) {
+  auto on_update = [this](Path const& path, vision::FrameTransformation const& new_tf) {
+    collect(path, new_tf);
+  };
 
-    auto tfs = msg->unpack<vision::FrameTransformations>();
-    if (!tfs) {
-      is::warn("event=Publisher.BadSchema");
-      return next_deadline();
-    }
+  // Recompute transformations using the graphs calculated earlier
+  tracker->update_batch(tfs, created_at, on_update);
 
-    for (auto&& tf : tfs->tfs()) {
-      // Recompute transformation using the graphs calculated earlier
-      // is::info("event=Publisher.Update from={} to={}", tf.from(), tf.to());
-      tracker->update(tf, [&](is::Path const& path, vision::FrameTransformation const& new_tf) {
-        auto topic = create_topic(path);
-        transformations[topic] = new_tf;
-      });
-    }
+  if (tfs.tfs_size() == 0) {
+    /* Dynamic sources are transformations that come from a detection process that can fail. An
+     * empty message indicates that the process failed. Therefore all the poses to dynamic frames
+     * related to that source should be removed otherwise we will compute new tfs using outdated
+     * values.
+     */
+    for (auto&& edge : leases.release(source.to_string())) { tracker->remove(edge, on_update); }
+    return;
+  }
 
-    if (tfs->tfs_size() == 0) {
-      /* If there is no tf we check if the message comes from a dynamic source. Dynamic sources are
-       * transformations that come from a detection process that can fail. The empty tf indicates
-       * that the proccess failed. Therefore all the poses related to that source should be removed
-       * otherwise we will compute new tfs using outdated values.
-       */
-      auto topic = msg->topic();
-      auto match = std::smatch{};
-      if (std::regex_match(topic, match, std::regex("ArUco.(\\d+).FrameTransformations"))) {
-        auto id = std::stoi(match[1]);
-        // Filter transformations that go from the camera id to any id on the dynamic range
-        auto edges_to_remove = std::vector<Edge>{};
-        for (auto&& edge_and_tensor : conversions->transformations()) {
-          auto edge = edge_and_tensor.first;
-          if (edge.from == id && (edge.to >= 100 && edge.to <= 150)) {
-            edges_to_remove.push_back(edge);
-          }
-        }
-
-        // Remove those transformations
-        for (auto&& edge : edges_to_remove) {
-          tracker->invalidate_edge(edge);
-          conversions->remove_transformation(edge);
-        }
-      }
-    }
+  auto source_name = source.to_string();
+  for (auto&& tf : tfs.tfs()) {
+    auto edge = Edge{tf.from(), tf.to()};
+    if (dynamic.contains(edge)) leases.refresh(edge, source_name, received_at, dynamic.ttl);
+  }
+}
+
+void TransformationPublisher::run(CalibrationDiff const& diff) {
+  auto on_update = [this](Path const& path, vision::FrameTransformation const& new_tf) {
+    collect(path, new_tf);
+  };
+  // Extrinsics are static, so there is no timestamp to keep them on a history
+  for (auto&& edge : diff.removed) {
+    leases.forget(edge);
+    tracker->remove(edge, on_update);
+  }
+  tracker->update_batch(diff.updated, on_update);
+}
+
+void TransformationPublisher::update_dependency(Path const& path, std::string const& consumer) {
+  auto maybe_transformation = tracker->update_dependency(path);
+  if (!maybe_transformation) return;
+  if (!aggregate_topic.empty()) {
+    collect(path, *maybe_transformation);
+    return;
+  }
+  // Counts as a publication for the keepalive
+  if (tracks_published()) {
+    published[path_topic(path)] = Published{*maybe_transformation,
+                                            to_pose(maybe_transformation->tf()),
+                                            std::chrono::system_clock::now()};
   }
+  publish(Publication{consumer, std::move(*maybe_transformation)});
+}
 
+void TransformationPublisher::remove_dependency(Path const& path) {
+  tracker->remove_dependency(path);
+  auto topic = path_topic(path);
+  transformations.erase(topic);
+  published.erase(topic);
+  held.erase(topic);
+}
+
+void TransformationPublisher::expire(FrameConversion::Timestamp now) {
+  auto on_update = [this](Path const& path, vision::FrameTransformation const& new_tf) {
+    collect(path, new_tf);
+  };
+  for (auto&& edge : leases.expire(now)) {
+    info("event=Publisher.Expired edge={}", edge);
+    tracker->remove(edge, on_update);
+  }
+}
+
+void TransformationPublisher::collect(Path const& path, vision::FrameTransformation const& tf) {
+  transformations[path_topic(path)] = tf;
+}
+
+auto TransformationPublisher::worth_publishing(std::string const& topic,
+                                               vision::FrameTransformation const& tf,
+                                               std::chrono::system_clock::time_point now) -> bool {
+  if (!tracks_published()) return true;
+  auto pose = to_pose(tf.tf());
+  auto it = published.find(topic);
+  if (thresholds.enabled() && it != published.end() && !keepalive_expired(it->second, now) &&
+      rotation_distance(it->second.pose, pose) <= thresholds.rotation &&
+      translation_distance(it->second.pose, pose) <= thresholds.translation) {
+    ++n_suppressed;
+    return false;
+  }
+  published[topic] = Published{tf, pose, now};
+  held.erase(topic);
+  return true;
+}
+
+auto TransformationPublisher::keepalive_expired(Published const& last,
+                                                std::chrono::system_clock::time_point now) const
+    -> bool {
+  return thresholds.keepalive.count() > 0 && now - last.at >= thresholds.keepalive;
+}
+
+auto TransformationPublisher::flush() -> std::chrono::system_clock::time_point {
   auto now = std::chrono::system_clock::now();
   if (now >= next_deadline()) {
-    for (auto&& key_val : transformations) {
-      auto topic = key_val.first;
-      auto transformation = key_val.second;
-      channel.publish(topic, Message{transformation});
-      // is::info("event=Publisher.Pub from={} to={}", transformation.from(), transformation.to());
+    /* Paths without a publication for keepalive go out again, with the last value held back if
+      any, unless a newer update is already pending */
+    for (auto&& topic_and_last : published) {
+      auto const& topic = topic_and_last.first;
+      if (transformations.count(topic) || !keepalive_expired(topic_and_last.second, now)) continue;
+      auto it = held.find(topic);
+      transformations.emplace(topic, it != held.end() ? it->second : topic_and_last.second.tf);
+    }
+
+    // Compared against the last published value, so slow drifts are still published eventually
+    for (auto it = transformations.begin(); it != transformations.end();) {
+      if (worth_publishing(it->first, it->second, now)) {
+        ++it;
+      } else {
+        if (thresholds.keepalive.count() > 0) held[it->first] = std::move(it->second);
+        it = transformations.erase(it);
+      }
+    }
+
+    if (aggregate_topic.empty()) {
+      for (auto&& key_val : transformations) {
+        publish(Publication{key_val.first, std::move(key_val.second)});
+        // is::info("event=Publisher.Pub topic={}", key_val.first);
+      }
+    } else {
+      // A message (serialized once) per list of hints, usually a single one for every update
+      auto batches = std::unordered_map<std::string, vision::FrameTransformations>{};
+      for (auto&& key_val : transformations) {
+        batches[batch_topic(aggregate_topic, key_val.first)].add_tfs()->Swap(&key_val.second);
+      }
+      for (auto&& topic_and_batch : batches) {
+        publish(Publication{topic_and_batch.first, std::move(topic_and_batch.second)});
+      }
     }
     transformations.clear();
     publish_deadline = now + throttle_interval;
@@ -99,4 +214,12 @@ auto TransformationPublisher::run(boost::optional<Message> const& msg)
   return next_deadline();
 }
 
+auto TransformationPublisher::pending() const -> std::size_t {
+  return transformations.size();
+}
+
+auto TransformationPublisher::suppressed() const -> uint64_t {
+  return n_suppressed;
+}
+
 }  // namespace is
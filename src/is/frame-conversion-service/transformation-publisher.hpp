@@ -1,34 +1,140 @@
 #pragma once
 
+#include <google/protobuf/timestamp.pb.h>
 #include <is/msgs/camera.pb.h>
+#include <boost/utility/string_view.hpp>
+#include <boost/variant.hpp>
 #include <chrono>
+#include <functional>
 #include <is/wire/core.hpp>
 #include <string>
 #include <vector>
+#include "calibration-server.hpp"
 #include "dependency-tracker.hpp"
+#include "frame-conversion/edge-leases.hpp"
 
 namespace is {
 
+/* Message to be sent to the broker, either a single transformation or, on an aggregate topic,
+  the updates of a throttle interval. Serialization is left to whoever publishes it. */
+struct Publication {
+  std::string topic;
+  boost::variant<vision::FrameTransformation, vision::FrameTransformations> payload;
+};
+
+auto to_message(Publication const&) -> Message;
+
+/* Time at which the sender created the message, which is when its poses were taken, or the given
+  receive time if the sender did not set it */
+auto created_at(Message const&, FrameConversion::Timestamp received_at)
+    -> FrameConversion::Timestamp;
+// Time point of a protobuf timestamp, e.g. the one a query or a point set is requested at
+auto to_timestamp(google::protobuf::Timestamp const&) -> FrameConversion::Timestamp;
+
+// Frames of objects that may disappear at any time, e.g. markers detected on camera images
+struct DynamicFrames {
+  int64_t first = 100;
+  int64_t last = 150;
+  // Edges to these frames are removed if not updated for this long, zero to keep them
+  std::chrono::milliseconds ttl{0};
+
+  auto contains(Edge const& edge) const -> bool {
+    return (edge.from >= first && edge.from <= last) || (edge.to >= first && edge.to <= last);
+  }
+};
+
+/* Smallest change worth publishing again on a path topic. Updates that move a transformation by
+  no more than both thresholds since its last publication are held back. Zero thresholds publish
+  every update that changed anything. Independently of the thresholds, every path is published
+  again once keepalive elapses since its last publication, with the last value held back or, if
+  there is none, the last value published. */
+struct ChangeThresholds {
+  // Angle of the relative rotation, in radians
+  double rotation = 0.0;
+  // Distance between the translations, in the units of the transformation
+  double translation = 0.0;
+  // Publish every path again this long after its last publication, zero to never do it
+  std::chrono::milliseconds keepalive{0};
+
+  auto enabled() const -> bool { return rotation > 0.0 || translation > 0.0; }
+};
+
 class TransformationPublisher {
-  Channel channel;
-  std::shared_ptr<opentracing::Tracer> tracer;
   DependencyTracker* tracker;
   FrameConversion* conversions;
+  /* Publish the updates of each throttle interval at once, empty to publish on each path topic.
+    Paths "<from>.<to>" go on this topic and paths with hints, "<from>.<hints...>.<to>", on
+    "<aggregate_topic>.<hints...>", one message per topic. Entries of a message then have distinct
+    from/to fields, which together with its topic tell the path they belong to. */
+  std::string aggregate_topic;
+  // Receives the messages to be published
+  std::function<void(Publication&&)> publish;
+  DynamicFrames dynamic;
+  // Source and expiry time of every edge to a dynamic frame
+  EdgeLeases leases;
+  ChangeThresholds thresholds;
+
+  /* Last value published on each path topic, to drop the updates below the thresholds and to
+    publish it again on keepalive. Only kept if either is enabled. */
+  struct Published {
+    vision::FrameTransformation tf;
+    Pose pose;
+    std::chrono::system_clock::time_point at;
+  };
+  std::unordered_map<std::string, Published> published;
+  /* Last value held back on each path topic for being below the thresholds, published instead of
+    the last published one once keepalive elapses */
+  std::unordered_map<std::string, vision::FrameTransformation> held;
+  // Updates held back for being below the thresholds
+  uint64_t n_suppressed;
 
   // Used to throttle message publication
   std::chrono::system_clock::time_point publish_deadline;
   std::unordered_map<std::string, vision::FrameTransformation> transformations;
 
-  // create topic from ids
-  auto create_topic(is::Path const& ids) -> std::string;
   auto next_deadline() -> std::chrono::system_clock::time_point;
+  // Whether the last published value of each path must be kept
+  auto tracks_published() const -> bool;
+  // Whether keepalive is set and has elapsed since the given publication
+  auto keepalive_expired(Published const&, std::chrono::system_clock::time_point now) const
+      -> bool;
+  // Whether the pending value of a topic moved enough since it was last published
+  auto worth_publishing(std::string const& topic, vision::FrameTransformation const&,
+                        std::chrono::system_clock::time_point now) -> bool;
+  // Keep the new value of a path until the next publication
+  void collect(Path const&, vision::FrameTransformation const&);
 
  public:
-  TransformationPublisher(Channel const&, Subscription*,
-                          std::shared_ptr<opentracing::Tracer> const&, DependencyTracker*,
-                          FrameConversion*);
+  // The subscription may be null if the messages are not consumed from a broker
+  TransformationPublisher(Subscription*, DependencyTracker*, FrameConversion*,
+                          std::function<void(Publication&&)> const& publish,
+                          std::string const& aggregate_topic = "",
+                          DynamicFrames const& dynamic = DynamicFrames{},
+                          ChangeThresholds const& thresholds = ChangeThresholds{});
 
-  auto run(boost::optional<Message> const&) -> std::chrono::system_clock::time_point;
+  /* Handle the content of a "<source>.FrameTransformations" message. The poses are kept on the
+    histories at the time the message was created, see created_at(), while the leases of dynamic
+    frames are refreshed on the time it was received, like they are expired. */
+  void run(vision::FrameTransformations const&, boost::string_view source,
+           FrameConversion::Timestamp received_at, FrameConversion::Timestamp created_at);
+  // Apply the changes on the extrinsics after the calibrations were reloaded
+  void run(CalibrationDiff const&);
+  /* Start updating a path when it gets a consumer and send it the current value of the path, if it
+    has a route. The value goes to the consumer right away when publishing on each path topic, or
+    on the next aggregate message otherwise, so that consumers only listen on its topic. */
+  void update_dependency(Path const&, std::string const& consumer);
+  /* Stop updating a path once it has no consumers left, forgetting everything pending, held back
+    or published on its topic */
+  void remove_dependency(Path const&);
+  // Remove the edges to dynamic frames that were not updated within their time to live
+  void expire(FrameConversion::Timestamp now);
+  /* Publish the pending transformations, and the paths whose keepalive expired, if the throttle
+    interval has elapsed. Returns when it should be called again. */
+  auto flush() -> std::chrono::system_clock::time_point;
+  // Number of topics with a transformation waiting to be published
+  auto pending() const -> std::size_t;
+  // Number of updates held back for being below the change thresholds
+  auto suppressed() const -> uint64_t;
 };
 
 }  // namespace is
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include "transformation-server.hpp"
+#include "transformation-publisher.hpp"
+
+namespace is {
+
+TransformationServer::TransformationServer(std::shared_ptr<FrameSnapshot const> const* s)
+    : snapshot(s) {}
+
+auto TransformationServer::get_transformations(Context*,
+                                               GetTransformationsRequest const& request,
+                                               GetTransformationsReply* reply) -> wire::Status {
+  // Every path is answered from the same snapshot, so the transformations are consistent
+  auto current = std::atomic_load(snapshot);
+  auto stamp = boost::optional<FrameConversion::Timestamp>{};
+  if (request.has_timestamp()) stamp = to_timestamp(request.timestamp());
+
+  for (auto&& frame_path : request.paths()) {
+    auto path = Path{frame_path.ids().begin(), frame_path.ids().end()};
+    if (path.size() < 2) {
+      return make_status(wire::StatusCode::INVALID_ARGUMENT,
+                         "A transformation path must contain atleast 2 ids");
+    }
+
+    auto route = current->find_path(path);
+    if (!route) return make_status(wire::StatusCode::NOT_FOUND, route.error());
+
+    auto transformation = reply->add_transformations();
+    transformation->set_from(path.front());
+    transformation->set_to(path.back());
+    // A path that starts and ends on the same frame may have a single frame route
+    if (route->size() < 2) {
+      *transformation->mutable_tf() = to_tensor(Pose::identity());
+    } else {
+      *transformation->mutable_tf() =
+          stamp ? current->compose_path(*route, *stamp) : current->compose_path(*route);
+    }
+  }
+  return make_status(wire::StatusCode::OK);
+}
+
+}  // namespace is
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <is/wire/rpc.hpp>
+#include <memory>
+#include "frame-conversion/frame-snapshot.hpp"
+#include "msgs/transformations.pb.h"
+
+namespace is {
+
+/* Answers transformation queries on demand, without the cost of watching the paths. Queries are
+  served from the latest snapshot of the graph, so they never wait for the graph updates. */
+class TransformationServer {
+  // Latest snapshot, replaced by the graph stage through std::atomic_store
+  std::shared_ptr<FrameSnapshot const> const* snapshot;
+
+ public:
+  TransformationServer(std::shared_ptr<FrameSnapshot const> const* snapshot);
+
+  auto get_transformations(Context*, GetTransformationsRequest const& request,
+                           GetTransformationsReply* reply) -> wire::Status;
+};
+
+}  // namespace is
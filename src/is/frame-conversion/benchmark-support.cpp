@@ -0,0 +1,75 @@
+#include "benchmark-support.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+}  // namespace
+
+// Replacing the global operator new is the only way to see the allocations made by std containers
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto* pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace is {
+
+auto topology_name(Topology topology) -> std::string {
+  switch (topology) {
+    case Topology::Star: return "star";
+    case Topology::Chain: return "chain";
+    case Topology::Bipartite: return "bipartite";
+  }
+  return "unknown";
+}
+
+static auto n_cameras(int64_t n_frames) -> int64_t {
+  return std::max<int64_t>(2, n_frames / 10);
+}
+
+auto synthetic_graph(Topology topology, int64_t n_frames, std::mt19937& gen)
+    -> std::vector<std::pair<Edge, Pose>> {
+  auto edges = std::vector<std::pair<Edge, Pose>>{};
+  if (topology == Topology::Star) {
+    for (int64_t frame = 1; frame < n_frames; ++frame) {
+      edges.emplace_back(Edge{0, frame}, random_pose(gen));
+    }
+  } else if (topology == Topology::Chain) {
+    for (int64_t frame = 1; frame < n_frames; ++frame) {
+      edges.emplace_back(Edge{frame - 1, frame}, random_pose(gen));
+    }
+  } else {
+    auto cameras = n_cameras(n_frames);
+    for (int64_t camera = 1; camera <= cameras; ++camera) {
+      edges.emplace_back(Edge{camera, 0}, random_pose(gen));
+    }
+    for (int64_t marker = cameras + 1; marker < n_frames; ++marker) {
+      edges.emplace_back(Edge{marker % cameras + 1, marker}, random_pose(gen));
+      edges.emplace_back(Edge{(marker + 1) % cameras + 1, marker}, random_pose(gen));
+    }
+  }
+  return edges;
+}
+
+auto distant_frames(Topology topology, int64_t n_frames) -> Edge {
+  if (topology == Topology::Star) return Edge{1, n_frames - 1};
+  if (topology == Topology::Chain) return Edge{0, n_frames - 1};
+  return Edge{n_cameras(n_frames) + 1, n_frames - 1};
+}
+
+auto allocation_count() -> uint64_t {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+}  // namespace is
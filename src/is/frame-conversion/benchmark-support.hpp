@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "edge.hpp"
+#include "pose.hpp"
+#include "test-support.hpp"
+
+namespace is {
+
+/* Shape of the synthetic graphs used on the benchmarks, frame 0 being the one most paths go
+  through:
+  - Star: every frame is connected directly to frame 0;
+  - Chain: frame i is connected to frame i + 1, paths may have as many hops as there are frames;
+  - Bipartite: a tenth of the frames are cameras connected to the world (frame 0), the others are
+    markers seen by two cameras each. */
+enum class Topology { Star, Chain, Bipartite };
+
+auto topology_name(Topology) -> std::string;
+
+// Edges of a graph with the given number of frames, ids go from 0 to n_frames - 1
+auto synthetic_graph(Topology, int64_t n_frames, std::mt19937&)
+    -> std::vector<std::pair<Edge, Pose>>;
+
+// Two frames of the graph with one of the longest paths between them
+auto distant_frames(Topology, int64_t n_frames) -> Edge;
+
+/* Number of heap allocations done by the process so far. Benchmarks linked with this file count
+  every allocation made through operator new. */
+auto allocation_count() -> uint64_t;
+
+}  // namespace is
@@ -0,0 +1,34 @@
+#include "composition-tree.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace is {
+
+CompositionTree::CompositionTree() : leaves(1), n_hops(0), nodes(2, Pose::identity()) {}
+
+CompositionTree::CompositionTree(std::vector<Pose> const& hops) : leaves(1), n_hops(hops.size()) {
+  while (leaves < n_hops) { leaves *= 2; }
+  // Unused leaves hold the identity so they do not affect the result
+  nodes.assign(2 * leaves, Pose::identity());
+  std::copy(hops.begin(), hops.end(), nodes.begin() + leaves);
+  for (auto node = leaves - 1; node > 0; --node) {
+    nodes[node] = nodes[2 * node + 1] * nodes[2 * node];
+  }
+}
+
+void CompositionTree::update(std::size_t hop, Pose const& pose) {
+  if (hop >= n_hops) { throw std::out_of_range{"Hop does not belong to the route"}; }
+  auto node = leaves + hop;
+  nodes[node] = pose;
+  for (node /= 2; node > 0; node /= 2) { nodes[node] = nodes[2 * node + 1] * nodes[2 * node]; }
+}
+
+auto CompositionTree::size() const -> std::size_t {
+  return n_hops;
+}
+
+auto CompositionTree::result() const -> Pose const& {
+  return nodes[1];
+}
+
+}  // namespace is
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "pose.hpp"
+
+namespace is {
+
+/* Segment tree over the hops of a route, where every node holds the composition of the hops on
+  its range. Replacing the transformation of a single hop only recomputes the nodes between its
+  leaf and the root, i.e. O(log n) products instead of composing the whole route again. Hops are
+  composed the same way FrameConversion::compose does, the last hop being the leftmost factor. */
+class CompositionTree {
+  // Number of leaves, the smallest power of two that fits all hops
+  std::size_t leaves;
+  std::size_t n_hops;
+  // Implicit binary tree, node i has children 2i and 2i+1 and leaves start at index "leaves"
+  std::vector<Pose> nodes;
+
+ public:
+  CompositionTree();
+  explicit CompositionTree(std::vector<Pose> const& hops);
+
+  // Replace the transformation of the given hop
+  void update(std::size_t hop, Pose const&);
+
+  auto size() const -> std::size_t;
+  // Composition of all the hops
+  auto result() const -> Pose const&;
+};
+
+}  // namespace is
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "composition-tree.hpp"
+#include "test-expectations.hpp"
+#include "test-support.hpp"
+
+namespace {
+
+TEST(CompositionTree, Interface) {
+  std::mt19937 gen(3);
+  is::expect_equal(is::CompositionTree{}.result(), is::Pose::identity());
+
+  for (std::size_t n_hops = 1; n_hops <= 9; ++n_hops) {
+    auto hops = std::vector<is::Pose>{};
+    for (std::size_t i = 0; i < n_hops; ++i) { hops.push_back(is::random_pose(gen)); }
+
+    auto compose = [&]() {
+      auto tf = is::Pose::identity();
+      for (auto const& hop : hops) { tf = hop * tf; }
+      return tf;
+    };
+
+    auto tree = is::CompositionTree{hops};
+    ASSERT_EQ(tree.size(), n_hops);
+    is::expect_equal(tree.result(), compose());
+
+    // Replace each hop at a time, the result must match composing the route from scratch
+    for (std::size_t i = 0; i < n_hops; ++i) {
+      hops[i] = is::random_pose(gen);
+      tree.update(i, hops[i]);
+      is::expect_equal(tree.result(), compose());
+    }
+  }
+
+  auto tree = is::CompositionTree{{is::Pose::identity()}};
+  EXPECT_THROW(tree.update(1, is::Pose::identity()), std::out_of_range);
+}
+
+}  // namespace
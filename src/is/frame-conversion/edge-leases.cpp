@@ -0,0 +1,141 @@
+#include "edge-leases.hpp"
+#include <algorithm>
+
+namespace is {
+
+EdgeLeases::EdgeLeases(Duration res)
+    : resolution(res.count() > 0 ? res : Duration{1}),
+      n_timers(0),
+      current(0),
+      started(false),
+      next_generation(0) {}
+
+auto EdgeLeases::tick(Timestamp stamp) const -> int64_t {
+  return std::chrono::duration_cast<Duration>(stamp.time_since_epoch()).count() /
+         resolution.count();
+}
+
+void EdgeLeases::start(Timestamp stamp) {
+  if (started) return;
+  current = tick(stamp);
+  started = true;
+}
+
+void EdgeLeases::schedule(Timer const& timer, int64_t deadline) {
+  auto delta = deadline - current;
+  auto level = std::size_t{0};
+  while (level + 1 < n_levels && delta >= (int64_t{1} << (slot_bits * (level + 1)))) { ++level; }
+  // Too far away even for the last level, it is rescheduled when the last level cascades
+  auto span = int64_t{1} << (slot_bits * n_levels);
+  if (delta >= span) deadline = current + span - 1;
+
+  auto slot = (deadline >> (slot_bits * level)) & static_cast<int64_t>(n_slots - 1);
+  wheel[level][slot].push_back(timer);
+  ++n_timers;
+}
+
+void EdgeLeases::cascade(std::size_t level) {
+  auto slot = (current >> (slot_bits * level)) & static_cast<int64_t>(n_slots - 1);
+  auto timers = std::vector<Timer>{};
+  timers.swap(wheel[level][slot]);
+  n_timers -= timers.size();
+
+  for (auto const& timer : timers) {
+    auto it = leases.find(timer.key);
+    if (it == leases.end() || it->second.generation != timer.generation) continue;
+    schedule(timer, it->second.deadline);
+  }
+}
+
+void EdgeLeases::erase(Edge const& key) {
+  auto it = leases.find(key);
+  if (it == leases.end()) return;
+  auto source = sources.find(it->second.source);
+  source->second.erase(key);
+  if (source->second.empty()) sources.erase(source);
+  leases.erase(it);
+}
+
+void EdgeLeases::refresh(Edge const& edge, std::string const& source, Timestamp stamp,
+                         Duration ttl) {
+  start(stamp);
+  auto key = sorted(edge);
+  // Expiring on the tick already processed would never happen, so it is at least the next one
+  auto deadline = ttl.count() > 0 ? std::max(tick(stamp + ttl), current + 1) : int64_t{-1};
+
+  auto it = leases.find(key);
+  if (it != leases.end()) {
+    auto& lease = it->second;
+    if (lease.source == source && lease.deadline == deadline && lease.edge == edge) return;
+    // Edges are not assignable, and the direction may have changed
+    if (lease.source != source || !(lease.edge == edge)) erase(key);
+  }
+
+  auto generation = ++next_generation;
+  it = leases.find(key);
+  if (it == leases.end()) {
+    leases.emplace(key, Lease{edge, source, deadline, generation});
+    sources[source].insert(key);
+  } else {
+    it->second.deadline = deadline;
+    it->second.generation = generation;
+  }
+  if (deadline >= 0) schedule(Timer{key, generation}, deadline);
+}
+
+void EdgeLeases::forget(Edge const& edge) {
+  erase(sorted(edge));
+}
+
+auto EdgeLeases::release(std::string const& source) -> std::vector<Edge> {
+  auto edges = std::vector<Edge>{};
+  auto it = sources.find(source);
+  if (it == sources.end()) return edges;
+
+  edges.reserve(it->second.size());
+  for (auto const& key : it->second) {
+    auto lease = leases.find(key);
+    edges.push_back(lease->second.edge);
+    leases.erase(lease);
+  }
+  sources.erase(it);
+  return edges;
+}
+
+auto EdgeLeases::expire(Timestamp stamp) -> std::vector<Edge> {
+  auto expired = std::vector<Edge>{};
+  start(stamp);
+  auto target = tick(stamp);
+
+  while (current < target) {
+    // Nothing to expire, no need to walk through the ticks in between
+    if (n_timers == 0) {
+      current = target;
+      break;
+    }
+
+    ++current;
+    for (auto level = std::size_t{1}; level < n_levels; ++level) {
+      // Cascade a level every time the one below it wraps around
+      if ((current & ((int64_t{1} << (slot_bits * level)) - 1)) != 0) break;
+      cascade(level);
+    }
+
+    auto timers = std::vector<Timer>{};
+    timers.swap(wheel[0][current & static_cast<int64_t>(n_slots - 1)]);
+    n_timers -= timers.size();
+    for (auto const& timer : timers) {
+      auto it = leases.find(timer.key);
+      if (it == leases.end() || it->second.generation != timer.generation) continue;
+      expired.push_back(it->second.edge);
+      erase(timer.key);
+    }
+  }
+  return expired;
+}
+
+auto EdgeLeases::size() const -> std::size_t {
+  return leases.size();
+}
+
+}  // namespace is
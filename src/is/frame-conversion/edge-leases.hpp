@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "edge.hpp"
+#include "pose-history.hpp"
+
+namespace is {
+
+/* Keeps which source provided each edge and until when the edge is valid, e.g:
+    Source "ArUco.1": [ Edge{1 -> 101}, Edge{1 -> 102} ]
+    Edge{1 -> 101}: expires at 12:00:00.500
+  Sources are indexed so all the edges of one of them are found in O(its edges). Expiry times live
+  on a hierarchical timing wheel, so refreshing an edge is O(1) and expiring them is O(expired)
+  plus O(1) per elapsed tick. */
+class EdgeLeases {
+ public:
+  using Timestamp = PoseHistory::Timestamp;
+  using Duration = std::chrono::milliseconds;
+
+ private:
+  // Each level has 64 slots, a slot of level n spans 64^n ticks
+  static constexpr int slot_bits = 6;
+  static constexpr std::size_t n_slots = std::size_t{1} << slot_bits;
+  static constexpr std::size_t n_levels = 4;
+
+  struct Lease {
+    // Edge as it was given, the leases are keyed by its sorted version
+    Edge edge;
+    std::string source;
+    // Tick the edge expires at, negative if it never expires
+    int64_t deadline;
+    // Timers of older refreshes of the same edge are ignored
+    uint64_t generation;
+  };
+
+  struct Timer {
+    Edge key;
+    uint64_t generation;
+  };
+
+  Duration resolution;
+  std::unordered_map<Edge, Lease, EdgeHash> leases;
+  std::unordered_map<std::string, std::unordered_set<Edge, EdgeHash>> sources;
+
+  // Timers are never removed from the wheel, outdated ones are dropped when their slot is reached
+  std::array<std::array<std::vector<Timer>, n_slots>, n_levels> wheel;
+  std::size_t n_timers;
+  // Last tick processed by the wheel
+  int64_t current;
+  bool started;
+  uint64_t next_generation;
+
+  auto tick(Timestamp) const -> int64_t;
+  void start(Timestamp);
+  void schedule(Timer const&, int64_t deadline);
+  // Move the timers of the slot of the given level to the lower levels
+  void cascade(std::size_t level);
+  void erase(Edge const& key);
+
+ public:
+  explicit EdgeLeases(Duration resolution = Duration{10});
+
+  /* Tag the edge with its source and extend its lease, ttl being counted from the given time. A
+    zero ttl keeps the edge until it is released or forgotten. */
+  void refresh(Edge const&, std::string const& source, Timestamp, Duration ttl);
+  // Stop tracking the edge
+  void forget(Edge const&);
+  // Stop tracking every edge of the source, returning them
+  auto release(std::string const& source) -> std::vector<Edge>;
+  // Advance the wheel up to the given time, returning the edges whose lease ran out
+  auto expire(Timestamp) -> std::vector<Edge>;
+
+  auto size() const -> std::size_t;
+};
+
+}  // namespace is
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "edge-leases.hpp"
+
+namespace {
+
+auto milliseconds(int64_t ms) -> is::EdgeLeases::Timestamp {
+  return is::EdgeLeases::Timestamp{} + std::chrono::milliseconds(ms);
+}
+
+TEST(EdgeLeases, Interface) {
+  auto leases = is::EdgeLeases{};
+  auto ttl = std::chrono::milliseconds(100);
+  leases.refresh(is::Edge{1, 101}, "ArUco.1", milliseconds(0), ttl);
+  leases.refresh(is::Edge{1, 102}, "ArUco.1", milliseconds(0), ttl);
+  leases.refresh(is::Edge{2, 101}, "ArUco.2", milliseconds(0), std::chrono::milliseconds(0));
+  ASSERT_EQ(leases.size(), 3u);
+
+  // Refreshing an edge keeps it alive for longer
+  leases.refresh(is::Edge{1, 102}, "ArUco.1", milliseconds(50), ttl);
+  ASSERT_TRUE(leases.expire(milliseconds(99)).empty());
+  ASSERT_EQ(leases.expire(milliseconds(100)), (std::vector<is::Edge>{{1, 101}}));
+  ASSERT_EQ(leases.expire(milliseconds(500)), (std::vector<is::Edge>{{1, 102}}));
+
+  // Edges without a ttl are only removed by releasing their source
+  ASSERT_TRUE(leases.release("ArUco.1").empty());
+  ASSERT_EQ(leases.release("ArUco.2"), (std::vector<is::Edge>{{2, 101}}));
+  ASSERT_EQ(leases.size(), 0u);
+
+  // Released and forgotten edges never expire
+  leases.refresh(is::Edge{1, 101}, "ArUco.1", milliseconds(500), ttl);
+  leases.refresh(is::Edge{2, 101}, "ArUco.2", milliseconds(500), ttl);
+  leases.forget(is::Edge{101, 2});
+  ASSERT_EQ(leases.release("ArUco.1"), (std::vector<is::Edge>{{1, 101}}));
+  ASSERT_TRUE(leases.expire(milliseconds(1000)).empty());
+
+  // An edge belongs to the last source that refreshed it
+  leases.refresh(is::Edge{1, 101}, "ArUco.1", milliseconds(1000), ttl);
+  leases.refresh(is::Edge{1, 101}, "ArUco.3", milliseconds(1000), ttl);
+  ASSERT_TRUE(leases.release("ArUco.1").empty());
+  ASSERT_EQ(leases.release("ArUco.3"), (std::vector<is::Edge>{{1, 101}}));
+}
+
+TEST(EdgeLeases, FarDeadlines) {
+  auto leases = is::EdgeLeases{std::chrono::milliseconds(1)};
+  // Spread over every level of the wheel, and beyond the last one
+  auto ttls = std::vector<int64_t>{1, 63, 64, 65, 4095, 4097, 300000, 16777215, 20000000};
+  for (std::size_t i = 0; i < ttls.size(); ++i) {
+    leases.refresh(is::Edge{0, static_cast<int64_t>(i + 1)}, "Source", milliseconds(7),
+                   std::chrono::milliseconds(ttls[i]));
+  }
+
+  // Expired exactly at their deadline, whatever the steps taken to get there
+  auto now = int64_t{7};
+  for (std::size_t i = 0; i < ttls.size(); ++i) {
+    auto deadline = 7 + ttls[i];
+    if (deadline - 1 > now) {
+      now = deadline - 1;
+      ASSERT_TRUE(leases.expire(milliseconds(now)).empty()) << ttls[i];
+    }
+    now = deadline;
+    ASSERT_EQ(leases.expire(milliseconds(now)),
+              (std::vector<is::Edge>{{0, static_cast<int64_t>(i + 1)}}))
+        << ttls[i];
+  }
+  ASSERT_EQ(leases.size(), 0u);
+}
+
+}  // namespace
@@ -13,6 +13,10 @@ auto inverted(Edge const& edge) -> Edge {
   return Edge{edge.to, edge.from};
 }
 
+auto inverted(Path const& path) -> Path {
+  return Path{path.rbegin(), path.rend()};
+}
+
 auto sorted(Edge const& edge) -> Edge {
   if (edge.from <= edge.to) return edge;
   return Edge{edge.to, edge.from};
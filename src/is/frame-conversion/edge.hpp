@@ -29,6 +29,9 @@ using EdgeHash = boost::hash<Edge>;
 using Path = std::vector<int64_t>;
 using PathHash = boost::hash<Path>;
 
+// Same frames walked on the opposite direction
+auto inverted(Path const&) -> Path;
+
 std::ostream& operator<<(std::ostream& os, Edge const&);
 
 }  // namespace is
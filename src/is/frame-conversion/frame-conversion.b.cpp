@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+#include "benchmark-support.hpp"
+#include "frame-conversion.hpp"
+#include "points.hpp"
+
+namespace {
+
+// Every benchmark runs on each topology, from tens to tens of thousands of frames
+void graph_sizes(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"topology", "frames"});
+  for (auto topology : {is::Topology::Star, is::Topology::Chain, is::Topology::Bipartite}) {
+    for (auto frames : {10, 100, 1000, 10000, 50000}) {
+      bench->Args({static_cast<int64_t>(topology), frames});
+    }
+  }
+}
+
+auto topology(benchmark::State const& state) -> is::Topology {
+  return static_cast<is::Topology>(state.range(0));
+}
+
+auto create_graph(benchmark::State& state) -> is::FrameConversion {
+  std::mt19937 gen(42);
+  auto conversions = is::FrameConversion{is::FrameConversion::Mode::Rigid};
+  conversions.update_transformations(is::synthetic_graph(topology(state), state.range(1), gen));
+  state.SetLabel(is::topology_name(topology(state)));
+  return conversions;
+}
+
+// Allocations done since the given count, per iteration of the benchmark
+void report_allocations(benchmark::State& state, uint64_t since) {
+  auto allocations = static_cast<double>(is::allocation_count() - since);
+  state.counters["allocs"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+void BM_UpdateTransformation(benchmark::State& state) {
+  auto conversions = create_graph(state);
+  std::mt19937 gen(7);
+  auto edges = is::synthetic_graph(topology(state), state.range(1), gen);
+
+  // Replaces the pose of existing edges, the topology never changes
+  auto i = std::size_t{0};
+  auto allocations = is::allocation_count();
+  for (auto _ : state) {
+    auto const& edge_and_pose = edges[i++ % edges.size()];
+    conversions.update_transformation(edge_and_pose.first, edge_and_pose.second);
+  }
+  report_allocations(state, allocations);
+}
+BENCHMARK(BM_UpdateTransformation)->Apply(graph_sizes);
+
+void BM_FindPathCached(benchmark::State& state) {
+  auto conversions = create_graph(state);
+  auto edge = is::distant_frames(topology(state), state.range(1));
+  benchmark::DoNotOptimize(conversions.find_path(edge));
+
+  auto allocations = is::allocation_count();
+  for (auto _ : state) { benchmark::DoNotOptimize(conversions.find_path(edge)); }
+  report_allocations(state, allocations);
+}
+BENCHMARK(BM_FindPathCached)->Apply(graph_sizes);
+
+void BM_FindPath(benchmark::State& state) {
+  auto conversions = create_graph(state);
+  auto edge = is::distant_frames(topology(state), state.range(1));
+  // Adding or removing an unrelated edge changes the topology, invalidating the cached routes
+  auto detached = is::Edge{-1, -2};
+
+  auto allocations = uint64_t{0};
+  for (auto _ : state) {
+    state.PauseTiming();
+    if (conversions.transformations().count(detached)) {
+      conversions.remove_transformation(detached);
+    } else {
+      conversions.update_transformation(detached, is::Pose::identity());
+    }
+    auto before = is::allocation_count();
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(conversions.find_path(edge));
+    allocations += is::allocation_count() - before;
+  }
+  state.counters["allocs"] =
+      benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_FindPath)->Apply(graph_sizes);
+
+void BM_FindPathHinted(benchmark::State& state) {
+  auto conversions = create_graph(state);
+  auto edge = is::distant_frames(topology(state), state.range(1));
+  // Passing through the middle of the chain, or the center (frame 0) of the other topologies
+  auto hint = topology(state) == is::Topology::Chain ? state.range(1) / 2 : int64_t{0};
+  auto hinted = is::Path{edge.from, hint, edge.to};
+  benchmark::DoNotOptimize(conversions.find_path(hinted));
+
+  auto allocations = is::allocation_count();
+  for (auto _ : state) { benchmark::DoNotOptimize(conversions.find_path(hinted)); }
+  report_allocations(state, allocations);
+}
+BENCHMARK(BM_FindPathHinted)->Apply(graph_sizes);
+
+void BM_ComposePath(benchmark::State& state) {
+  auto conversions = create_graph(state);
+  auto path = *conversions.find_path(is::distant_frames(topology(state), state.range(1)));
+
+  auto allocations = is::allocation_count();
+  for (auto _ : state) { benchmark::DoNotOptimize(conversions.compose_path(path)); }
+  report_allocations(state, allocations);
+  state.counters["hops"] = static_cast<double>(path.size() - 1);
+}
+BENCHMARK(BM_ComposePath)->Apply(graph_sizes);
+
+// Points per call, from a skeleton to a point cloud. Second argument: 0 interleaved, 1 separate
+void BM_TransformPoints(benchmark::State& state) {
+  std::mt19937 gen(42);
+  auto pose = is::random_pose(gen);
+  auto n = static_cast<std::size_t>(state.range(0));
+  auto coordinates = std::vector<double>(3 * n, 1.0);
+  auto separate = state.range(1) != 0;
+  state.SetLabel(separate ? "separate" : "interleaved");
+
+  for (auto _ : state) {
+    if (separate) {
+      is::transform_points(pose, &coordinates[0], &coordinates[n], &coordinates[2 * n], n);
+    } else {
+      is::transform_points(pose, coordinates.data(), n);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_TransformPoints)->ArgNames({"points", "layout"})->Ranges({{25, 100000}, {0, 1}});
+
+}  // namespace
+
+BENCHMARK_MAIN();
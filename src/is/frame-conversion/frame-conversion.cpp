@@ -1,10 +1,15 @@
 #include "frame-conversion.hpp"
 #include <algorithm>
-#include <is/msgs/cv.hpp>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <numeric>
 
 namespace is {
 
+// Changes remembered by changes_since(), enough for snapshots taken after every few updates
+static constexpr std::size_t max_changes = 4096;
+
 template <typename I, typename P>
 I adjacent_for_each(I first, I last, P&& predicate) {
   if (first == last) return first;
@@ -29,28 +34,102 @@ InputIt adjacent_transform_if(InputIt s_first, InputIt s_last, OutputIt d_first,
   return s_second;
 }
 
+// Concatenate the routes found between every pair of consecutive frames of the given path
+template <typename F>
+static auto join_routes(Path const& p, F&& find_each_subpath) -> expected<Path, std::string> {
+  if (p.size() < 2) {
+    throw std::invalid_argument{"A transformation path must contain atleast 2 ids"};
+  }
+  auto subpaths = std::vector<expected<Path, std::string>>{};
+
+  auto ok = adjacent_transform_if(p.begin(), p.end(), std::back_inserter(subpaths),
+                                  find_each_subpath) == p.end();
+
+  if (!ok) return subpaths.back();
+
+  auto concatenated = Path{};
+  auto overall_size = std::accumulate(
+      subpaths.begin(), subpaths.end(), 0,
+      [](int total, expected<Path, std::string> const& path) { return total + path->size(); });
+  concatenated.reserve(overall_size);
+
+  auto first = subpaths.begin();
+  auto last = subpaths.end();
+  concatenated.insert(concatenated.end(), (*first)->begin(), (*first)->end());
+  ++first;
+
+  while (first != last) {
+    concatenated.insert(concatenated.end(), (*first)->begin() + 1, (*first)->end());
+    ++first;
+  }
+  return concatenated;
+}
+
+FrameConversion::FrameConversion(Mode m)
+    : mode(m),
+      history_depth(1),
+      poses_version(0),
+      topology(0),
+      routes_topology(0),
+      routes_hits(0),
+      routes_misses(0),
+      searches(0),
+      hops(0),
+      components_outdated(false),
+      components_generation(0) {}
+
+void FrameConversion::touch(Edge const& edge) {
+  ++poses_version;
+  changes.emplace_back(poses_version, sorted(edge));
+  if (changes.size() > max_changes) changes.pop_front();
+}
+
 auto FrameConversion::has_vertex(int64_t id) const -> bool {
-  return vertices.find(id) != vertices.end();
+  return graph.find_vertex(id) != FrameGraph::null_vertex();
 }
 
 auto FrameConversion::get_vertex(int64_t id) const -> Vertex {
-  return vertices.find(id)->second;
+  return graph.find_vertex(id);
 }
 
 auto FrameConversion::add_vertex(int64_t id) -> Vertex {
   if (has_vertex(id)) return get_vertex(id);
-  auto vertex = boost::add_vertex(id, graph);
-  vertices[id] = vertex;
+  auto vertex = graph.add_vertex(id);
+
+  // The vertex is either new or is reusing the slot of a removed one
+  for (auto& root_and_tree : trees) {
+    auto& tree = root_and_tree.second;
+    tree.distances.resize(graph.num_vertices());
+    tree.predecessors.resize(graph.num_vertices());
+    tree.distances[vertex] =
+        root_and_tree.first == id ? 0.0f : std::numeric_limits<float>::infinity();
+    tree.predecessors[vertex] = vertex;
+  }
+
+  parents.resize(graph.num_vertices());
+  sizes.resize(graph.num_vertices());
+  parents[vertex] = vertex;
+  sizes[vertex] = 1;
   return vertex;
 }
 
-void FrameConversion::remove_vertex(int64_t) {
-  throw std::runtime_error{"Method not implemented"};
+void FrameConversion::remove_vertex(Vertex vertex) {
+  // Only isolated vertices are removed, so trees just have to forget about a removed root
+  for (auto& root_and_tree : trees) {
+    root_and_tree.second.distances[vertex] = std::numeric_limits<float>::infinity();
+  }
+  graph.remove_vertex(vertex);
 }
 
 void FrameConversion::add_edge(Edge const& edge, float weight) {
   auto sorted_edge = sorted(edge);
-  boost::add_edge(add_vertex(sorted_edge.from), add_vertex(sorted_edge.to), weight, graph);
+  auto from = add_vertex(sorted_edge.from);
+  auto to = add_vertex(sorted_edge.to);
+  graph.add_edge(from, to, weight);
+  ++topology;
+  if (!components_outdated) merge_components(from, to);
+
+  for (auto& root_and_tree : trees) { tree_edge_added(root_and_tree.second, from, to, weight); }
 }
 
 void FrameConversion::remove_edge(Edge const& edge) {
@@ -58,28 +137,325 @@ void FrameConversion::remove_edge(Edge const& edge) {
   if (!has_vertex(sorted_edge.from) || !has_vertex(sorted_edge.to)) {
     throw std::logic_error{"Trying to remove an edge from vertices that do not exist"};
   }
-  boost::remove_edge(get_vertex(sorted_edge.from), get_vertex(sorted_edge.to), graph);
+  auto from = get_vertex(sorted_edge.from);
+  auto to = get_vertex(sorted_edge.to);
+  graph.remove_edge(from, to);
+  ++topology;
+  components_outdated = true;
+  ++components_generation;
+
+  for (auto& root_and_tree : trees) { tree_edge_removed(root_and_tree.second, from, to); }
+
+  // Frames that are no longer connected to anything leave the graph
+  if (graph.degree(from) == 0) remove_vertex(from);
+  if (to != from && graph.degree(to) == 0) remove_vertex(to);
+}
+
+void FrameConversion::keep_tree(int64_t root) {
+  if (trees.find(root) != trees.end()) return;
+  ++searches;
+  build_tree(root, trees[root], FrameGraph::null_vertex());
+  // Routes to the root now come from the tree, which may break ties differently
+  ++topology;
+}
+
+void FrameConversion::drop_tree(int64_t root) {
+  if (trees.erase(root)) ++topology;
+}
+
+auto FrameConversion::keeps_tree(int64_t root) const -> bool {
+  return trees.find(root) != trees.end();
+}
+
+auto FrameConversion::component(int64_t id) const -> int64_t {
+  if (!has_vertex(id)) return id;
+  if (components_outdated) rebuild_components();
+  return graph.id(find_component(get_vertex(id)));
+}
+
+auto FrameConversion::components_version() const -> uint64_t {
+  return components_generation;
+}
+
+auto FrameConversion::find_component(Vertex vertex) const -> Vertex {
+  // Path halving, every visited vertex ends up pointing to its grandparent
+  while (parents[vertex] != vertex) {
+    parents[vertex] = parents[parents[vertex]];
+    vertex = parents[vertex];
+  }
+  return vertex;
+}
+
+void FrameConversion::merge_components(Vertex u, Vertex v) const {
+  u = find_component(u);
+  v = find_component(v);
+  if (u == v) return;
+  if (sizes[u] < sizes[v]) std::swap(u, v);
+  parents[v] = u;
+  sizes[u] += sizes[v];
+}
+
+void FrameConversion::rebuild_components() const {
+  std::iota(parents.begin(), parents.end(), Vertex{0});
+  std::fill(sizes.begin(), sizes.end(), 1);
+  for (Vertex vertex = 0; vertex < graph.num_vertices(); ++vertex) {
+    for (auto const& arc : graph.arcs(vertex)) {
+      if (vertex < arc.target) merge_components(vertex, arc.target);
+    }
+  }
+  components_outdated = false;
+}
+
+void FrameConversion::build_tree(int64_t root, Tree& tree, Vertex target) const {
+  auto n_vertices = graph.num_vertices();
+  tree.distances.assign(n_vertices, std::numeric_limits<float>::infinity());
+  tree.predecessors.resize(n_vertices);
+  std::iota(tree.predecessors.begin(), tree.predecessors.end(), Vertex{0});
+  if (!has_vertex(root)) return;
+
+  auto vertex = get_vertex(root);
+  tree.distances[vertex] = 0.0f;
+  auto heap = std::vector<std::pair<float, Vertex>>{{0.0f, vertex}};
+  propagate_tree(tree, heap, target);
+}
+
+void FrameConversion::propagate_tree(Tree& tree, std::vector<std::pair<float, Vertex>>& heap,
+                                     Vertex target) const {
+  using Entry = std::pair<float, Vertex>;
+  auto compare = std::greater<Entry>{};
+  std::make_heap(heap.begin(), heap.end(), compare);
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), compare);
+    auto entry = heap.back();
+    heap.pop_back();
+    auto vertex = entry.second;
+    // Outdated entry, the vertex was already reached through a shorter path
+    if (entry.first > tree.distances[vertex]) continue;
+    if (vertex == target) return;
+
+    for (auto const& arc : graph.arcs(vertex)) {
+      auto neighbor = arc.target;
+      auto distance = entry.first + arc.weight;
+      if (distance < tree.distances[neighbor]) {
+        tree.distances[neighbor] = distance;
+        tree.predecessors[neighbor] = vertex;
+        heap.emplace_back(distance, neighbor);
+        std::push_heap(heap.begin(), heap.end(), compare);
+      }
+    }
+  }
+}
+
+void FrameConversion::tree_edge_added(Tree& tree, Vertex u, Vertex v, float weight) const {
+  auto heap = std::vector<std::pair<float, Vertex>>{};
+  auto relax = [&](Vertex from, Vertex to) {
+    auto distance = tree.distances[from] + weight;
+    if (distance < tree.distances[to]) {
+      tree.distances[to] = distance;
+      tree.predecessors[to] = from;
+      heap.emplace_back(distance, to);
+    }
+  };
+  relax(u, v);
+  relax(v, u);
+  propagate_tree(tree, heap);
+}
+
+void FrameConversion::tree_edge_removed(Tree& tree, Vertex u, Vertex v) const {
+  // Only the subtree hanging from a removed tree edge loses its routes to the root
+  auto child = Vertex{};
+  if (tree.predecessors[v] == u && v != u) {
+    child = v;
+  } else if (tree.predecessors[u] == v && u != v) {
+    child = u;
+  } else {
+    return;
+  }
+
+  auto subtree = std::vector<Vertex>{child};
+  for (std::size_t i = 0; i < subtree.size(); ++i) {
+    for (auto const& arc : graph.arcs(subtree[i])) {
+      if (tree.predecessors[arc.target] == subtree[i] && arc.target != subtree[i]) {
+        subtree.push_back(arc.target);
+      }
+    }
+  }
+  for (auto vertex : subtree) {
+    tree.distances[vertex] = std::numeric_limits<float>::infinity();
+    tree.predecessors[vertex] = vertex;
+  }
+
+  // Reconnect the subtree through its best neighbor outside of it and propagate from there
+  auto heap = std::vector<std::pair<float, Vertex>>{};
+  for (auto vertex : subtree) {
+    for (auto const& arc : graph.arcs(vertex)) {
+      auto distance = tree.distances[arc.target] + arc.weight;
+      if (distance < tree.distances[vertex]) {
+        tree.distances[vertex] = distance;
+        tree.predecessors[vertex] = arc.target;
+      }
+    }
+    if (tree.predecessors[vertex] != vertex) heap.emplace_back(tree.distances[vertex], vertex);
+  }
+  propagate_tree(tree, heap);
 }
 
 auto FrameConversion::transformations() const
-    -> std::unordered_map<Edge, common::Tensor, EdgeHash> const& {
-  return tensors;
+    -> std::unordered_map<Edge, Pose, EdgeHash> const& {
+  return poses;
+}
+
+auto FrameConversion::conversion_mode() const -> Mode {
+  return mode;
+}
+
+auto FrameConversion::version() const -> uint64_t {
+  return poses_version;
+}
+
+auto FrameConversion::changes_since(uint64_t version) const
+    -> boost::optional<std::vector<Edge>> {
+  if (version >= poses_version) return std::vector<Edge>{};
+  // Versions on the log are consecutive, the first one missing means the changes were dropped
+  if (changes.empty() || changes.front().first > version + 1) return boost::none;
+
+  auto edges = std::vector<Edge>{};
+  edges.reserve(poses_version - version);
+  for (auto it = changes.begin() + (version + 1 - changes.front().first); it != changes.end();
+       ++it) {
+    edges.push_back(it->second);
+  }
+  return edges;
+}
+
+auto FrameConversion::topology_version() const -> uint64_t {
+  return topology;
+}
+
+auto FrameConversion::route_cache_hits() const -> uint64_t {
+  return routes_hits;
+}
+
+auto FrameConversion::route_cache_misses() const -> uint64_t {
+  return routes_misses;
+}
+
+auto FrameConversion::dijkstra_runs() const -> uint64_t {
+  return searches;
+}
+
+auto FrameConversion::composed_hops() const -> uint64_t {
+  return hops;
+}
+
+auto FrameConversion::num_frames() const -> std::size_t {
+  return graph.size();
+}
+
+auto FrameConversion::update_transformation(vision::FrameTransformation const& transformation)
+    -> bool {
+  return update_transformation(Edge{transformation.from(), transformation.to()},
+                               transformation.tf());
+}
+
+auto FrameConversion::update_transformation(Edge const& edge, common::Tensor const& tensor)
+    -> bool {
+  return update_transformation(edge, to_pose(tensor));
+}
+
+auto FrameConversion::update_transformation(Edge const& edge, Pose const& pose) -> bool {
+  auto changed = store(edge, pose);
+  // Dropping the history changes the timed lookups even if the latest pose is the same
+  if (histories.erase(edge) && !changed) touch(edge);
+  return changed;
+}
+
+auto FrameConversion::update_transformations(
+    std::vector<std::pair<Edge, Pose>> const& transformations)
+    -> std::vector<std::pair<Edge, std::string>> {
+  auto roots = std::vector<int64_t>{};
+  for (auto const& root_and_tree : trees) { roots.push_back(root_and_tree.first); }
+  trees.clear();
+
+  auto errors = std::vector<std::pair<Edge, std::string>>{};
+  poses.reserve(poses.size() + transformations.size());
+  for (auto const& edge_and_pose : transformations) {
+    try {
+      store(edge_and_pose.first, edge_and_pose.second);
+      histories.erase(edge_and_pose.first);
+    } catch (std::invalid_argument const& e) {
+      errors.emplace_back(edge_and_pose.first, e.what());
+    }
+  }
+
+  for (auto root : roots) {
+    ++searches;
+    build_tree(root, trees[root], FrameGraph::null_vertex());
+  }
+  return errors;
+}
+
+auto FrameConversion::update_transformation(vision::FrameTransformation const& transformation,
+                                            Timestamp stamp) -> bool {
+  return update_transformation(Edge{transformation.from(), transformation.to()},
+                               to_pose(transformation.tf()), stamp);
+}
+
+auto FrameConversion::update_transformation(Edge const& edge, Pose const& pose, Timestamp stamp)
+    -> bool {
+  auto changed = store(edge, pose);
+  if (history_depth <= 1) return changed;
+  auto it = histories.find(edge);
+  if (it == histories.end()) {
+    it = histories.emplace(edge, PoseHistory{history_depth, mode == Mode::Rigid}).first;
+  }
+  it->second.insert(stamp, pose);
+  // A new entry on the history changes the timed lookups even if the latest pose is the same
+  if (!changed) touch(edge);
+  return changed;
+}
+
+void FrameConversion::set_history_depth(std::size_t depth) {
+  history_depth = depth;
 }
 
-void FrameConversion::update_transformation(vision::FrameTransformation const& transformation) {
-  update_transformation(Edge{transformation.from(), transformation.to()}, transformation.tf());
+auto FrameConversion::pose_histories() const -> Histories const& {
+  return histories;
 }
 
-void FrameConversion::update_transformation(Edge const& edge, common::Tensor const& tensor) {
-  // TODO: check if matrix is invertible before inserting
-  auto matrix = is::to_mat(tensor);
-  matrix.convertTo(matrix, CV_64F);
+auto FrameConversion::store(Edge const& edge, Pose const& pose) -> bool {
+  auto it = poses.find(edge);
+  // Same value sent again (e.g. static markers), it was already validated
+  if (it != poses.end() && it->second.data == pose.data) return false;
 
-  auto not_found = tensors.find(edge) == tensors.end();
-  if (not_found) add_edge(edge);
+  // The transformation of a frame to itself is always the identity, it is not an edge
+  if (edge.from == edge.to) {
+    throw std::invalid_argument{
+        fmt::format("Transformation \"{} -> {}\" is a loop", edge.from, edge.to)};
+  }
+  if (mode == Mode::Rigid) {
+    if (!is_rigid(pose)) {
+      throw std::invalid_argument{
+          fmt::format("Transformation \"{} -> {}\" is not rigid", edge.from, edge.to)};
+    }
+  } else if (is_singular(pose)) {
+    throw std::invalid_argument{
+        fmt::format("Transformation \"{} -> {}\" is singular", edge.from, edge.to)};
+  }
 
-  tensors[edge] = is::to_tensor(matrix);
-  tensors[inverted(edge)] = is::to_tensor(matrix.inv());
+  touch(edge);
+  if (it != poses.end()) {
+    it->second = pose;
+    return true;
+  }
+
+  // Edge was given before on the opposite direction, replace it keeping the graph untouched
+  auto erased = poses.erase(inverted(edge));
+  histories.erase(inverted(edge));
+  if (!erased) add_edge(edge);
+  poses.emplace(edge, pose);
+  return true;
 }
 
 void FrameConversion::remove_transformation(vision::FrameTransformation const& transformation) {
@@ -87,14 +463,59 @@ void FrameConversion::remove_transformation(vision::FrameTransformation const& t
 }
 
 void FrameConversion::remove_transformation(Edge const& edge) {
-  auto removed = tensors.erase(edge);
+  auto removed = poses.erase(edge) || poses.erase(inverted(edge));
   if (!removed) return;
-  tensors.erase(inverted(edge));
+  histories.erase(edge);
+  histories.erase(inverted(edge));
+  touch(edge);
   remove_edge(edge);
-  // TODO: remove_vertex when there is no edges to it
+}
+
+auto FrameConversion::without_poses() const -> FrameConversion {
+  auto copy = FrameConversion{mode};
+  copy.graph = graph;
+  copy.topology = topology;
+  copy.routes = routes;
+  copy.routes_topology = routes_topology;
+  copy.trees = trees;
+  copy.parents = parents;
+  copy.sizes = sizes;
+  copy.components_outdated = components_outdated;
+  copy.components_generation = components_generation;
+  return copy;
 }
 
 auto FrameConversion::find_path(Edge const& edge) const -> expected<Path, std::string> {
+  if (routes_topology != topology) {
+    // Every cached route was computed on an older topology
+    routes.clear();
+    routes_topology = topology;
+  }
+
+  auto cached = routes.find(edge);
+  if (cached != routes.end()) {
+    ++routes_hits;
+    return cached->second;
+  }
+
+  ++routes_misses;
+  auto route = search_path(edge, searches);
+  routes.emplace(edge, route);
+  return route;
+}
+
+auto FrameConversion::find_path_uncached(Edge const& edge) const -> expected<Path, std::string> {
+  // Read only, the cache is used only if it is up to date and new searches are not counted
+  if (routes_topology == topology) {
+    auto cached = routes.find(edge);
+    if (cached != routes.end()) return cached->second;
+  }
+  auto searched = uint64_t{0};
+  return search_path(edge, searched);
+}
+
+auto FrameConversion::search_path(Edge const& edge, uint64_t& searched) const
+    -> expected<Path, std::string> {
   if (!has_vertex(edge.from)) {
     return make_unexpected(fmt::format("Invalid frame id \"{}\"", edge.from));
   }
@@ -102,12 +523,21 @@ auto FrameConversion::find_path(Edge const& edge) const -> expected<Path, std::s
     return make_unexpected(fmt::format("Invalid frame id \"{}\"", edge.to));
   }
 
+  auto tree = trees.find(edge.to);
+  if (tree != trees.end()) return walk_path(edge, tree->second.predecessors);
+
+  // Search from the destination, stopping as soon as the origin is reached
+  auto search = Tree{};
+  ++searched;
+  build_tree(edge.to, search, get_vertex(edge.from));
+  return walk_path(edge, search.predecessors);
+}
+
+auto FrameConversion::walk_path(Edge const& edge, std::vector<Vertex> const& predecessors) const
+    -> expected<Path, std::string> {
   auto from = get_vertex(edge.from);
   auto to = get_vertex(edge.to);
 
-  std::vector<Vertex> predecessors(boost::num_vertices(graph));
-  boost::dijkstra_shortest_paths(graph, to, boost::predecessor_map(&predecessors[0]));
-
   auto path = Path{};
   path.reserve(4);
   while (from != to) {
@@ -115,58 +545,79 @@ auto FrameConversion::find_path(Edge const& edge) const -> expected<Path, std::s
     if (next == from)
       return make_unexpected(
           fmt::format("Frames \"{}\" and \"{}\" are not connected", edge.from, edge.to));
-    path.push_back(graph[from]);
+    path.push_back(graph.id(from));
     from = next;
   }
-  path.push_back(graph[from]);
+  path.push_back(graph.id(from));
   return path;
 }
 
 auto FrameConversion::find_path(Path const& p) const -> expected<Path, std::string> {
-  if (p.size() < 2) {
+  return join_routes(p, [this](int64_t from, int64_t to) { return find_path(Edge{from, to}); });
+}
+
+auto FrameConversion::find_path_uncached(Path const& p) const -> expected<Path, std::string> {
+  return join_routes(
+      p, [this](int64_t from, int64_t to) { return find_path_uncached(Edge{from, to}); });
+}
+
+auto FrameConversion::compose(Path const& path) const -> Pose {
+  if (path.size() < 2) {
     throw std::invalid_argument{"A transformation path must contain atleast 2 ids"};
   }
-  auto subpaths = std::vector<expected<Path, std::string>>{};
 
-  auto find_each_subpath = [this](int64_t from, int64_t to) { return find_path(Edge{from, to}); };
-  auto ok = adjacent_transform_if(p.begin(), p.end(), std::back_inserter(subpaths),
-                                  find_each_subpath) == p.end();
-
-  if (!ok) return subpaths.back();
+  auto tf = Pose::identity();
+  adjacent_for_each(path.begin(), path.end(),
+                    [&](int64_t from, int64_t to) { tf = hop(from, to) * tf; });
+  return tf;
+}
 
-  auto concatenated = Path{};
-  auto overall_size = std::accumulate(
-      subpaths.begin(), subpaths.end(), 0,
-      [](int total, expected<Path, std::string> const& path) { return total + path->size(); });
-  concatenated.reserve(overall_size);
+auto FrameConversion::invert(Pose const& pose) const -> Pose {
+  return mode == Mode::Rigid ? rigid_inverse(pose) : inverse(pose);
+}
 
-  auto first = subpaths.begin();
-  auto last = subpaths.end();
-  concatenated.insert(concatenated.end(), (*first)->begin(), (*first)->end());
-  ++first;
+auto FrameConversion::hop(int64_t from, int64_t to) const -> Pose {
+  ++hops;
+  auto forward = poses.find(Edge{from, to});
+  if (forward != poses.end()) return forward->second;
 
-  while (first != last) {
-    concatenated.insert(concatenated.end(), (*first)->begin() + 1, (*first)->end());
-    ++first;
+  auto backward = poses.find(Edge{to, from});
+  if (backward == poses.end()) {
+    throw std::logic_error{"Transformation exists but no pose found"};
   }
-  return concatenated;
+  return invert(backward->second);
 }
 
 auto FrameConversion::compose_path(Path const& path) const -> common::Tensor {
+  return to_tensor(compose(path));
+}
+
+auto FrameConversion::hop(int64_t from, int64_t to, Timestamp stamp) const -> Pose {
+  auto forward = histories.find(Edge{from, to});
+  if (forward != histories.end()) {
+    ++hops;
+    return forward->second.at(stamp);
+  }
+
+  auto backward = histories.find(Edge{to, from});
+  if (backward == histories.end()) return hop(from, to);
+  ++hops;
+  return invert(backward->second.at(stamp));
+}
+
+auto FrameConversion::compose(Path const& path, Timestamp stamp) const -> Pose {
   if (path.size() < 2) {
     throw std::invalid_argument{"A transformation path must contain atleast 2 ids"};
   }
 
-  auto tf = cv::Mat::eye(4, 4, CV_64F);
-  adjacent_for_each(path.begin(), path.end(), [&](int64_t from, int64_t to) {
-    auto tensor = tensors.find(Edge{from, to});
-    if (tensor == tensors.end()) {
-      throw std::logic_error{"Transformation exists but no tensor found"};
-    }
-    tf = is::to_mat(tensor->second) * tf;
-  });
+  auto tf = Pose::identity();
+  adjacent_for_each(path.begin(), path.end(),
+                    [&](int64_t from, int64_t to) { tf = hop(from, to, stamp) * tf; });
+  return tf;
+}
 
-  return is::to_tensor(tf);
-}  // namespace is
+auto FrameConversion::compose_path(Path const& path, Timestamp stamp) const -> common::Tensor {
+  return to_tensor(compose(path, stamp));
+}
 
 }  // namespace is
\ No newline at end of file
@@ -3,54 +3,209 @@
 #include <fmt/format.h>
 #include <is/msgs/camera.pb.h>
 #include <is/msgs/common.pb.h>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/dijkstra_shortest_paths.hpp>
-#include <boost/graph/graph_traits.hpp>
 #include <boost/optional.hpp>
+#include <deque>
 #include <tl/expected.hpp>
 #include <unordered_map>
+#include <vector>
 #include "edge.hpp"
+#include "frame-graph.hpp"
+#include "pose-history.hpp"
+#include "pose.hpp"
 
 namespace is {
 
 using namespace tl;
 
 class FrameConversion {
-  using Graph = boost::adjacency_list<boost::listS, boost::vecS, boost::undirectedS, int64_t,
-                                      boost::property<boost::edge_weight_t, float>>;
-  using Vertex = boost::graph_traits<Graph>::vertex_descriptor;
+ public:
+  enum class Mode {
+    // Any invertible 4x4 matrix is accepted
+    General,
+    // Only rigid transformations (rotation + translation) are accepted, allowing the inverse of
+    // an edge to be computed in closed form
+    Rigid,
+  };
+  using Timestamp = PoseHistory::Timestamp;
+  using Histories = std::unordered_map<Edge, PoseHistory, EdgeHash>;
+
+ private:
+  using Vertex = FrameGraph::Vertex;
+
+  /* Shortest path tree rooted at a given frame, kept up to date while edges are added and
+    removed. Following the predecessors of any vertex leads to the root, unreachable vertices
+    are their own predecessor. */
+  struct Tree {
+    std::vector<float> distances;
+    std::vector<Vertex> predecessors;
+  };
+
+  Mode mode;
+  // Each edge is stored once, on the direction it was given. Walking it backwards inverts it.
+  std::unordered_map<Edge, Pose, EdgeHash> poses;
+  /* Last poses of the edges that were updated with a timestamp, on the same direction as they
+    are stored on "poses". Edges updated without one are static and only have their last pose. */
+  Histories histories;
+  std::size_t history_depth;
+  FrameGraph graph;
+
+  // Incremented every time a transformation is updated or removed
+  uint64_t poses_version;
+  /* Edge changed on each of the last versions, oldest first, so a copy of the transformations
+    (e.g. a FrameSnapshot) can be brought up to date with only what changed since it was taken */
+  std::deque<std::pair<uint64_t, Edge>> changes;
+  // Incremented every time an edge is added or removed
+  uint64_t topology;
+  // Routes found by find_path, valid only while the topology does not change
+  mutable std::unordered_map<Edge, expected<Path, std::string>, EdgeHash> routes;
+  mutable uint64_t routes_topology;
+  mutable uint64_t routes_hits;
+  mutable uint64_t routes_misses;
+  // Shortest path searches run and hops composed so far, cheap enough to always be counted
+  mutable uint64_t searches;
+  mutable uint64_t hops;
 
-  std::unordered_map<Edge, common::Tensor, EdgeHash> tensors;
-  Graph graph;
-  std::unordered_map<int64_t, Vertex> vertices;
+  // Shortest path trees indexed by the frame id of their root
+  std::unordered_map<int64_t, Tree> trees;
+
+  /* Union-find over the vertices to tell connected components apart without searching. Edge
+    insertions merge components as they happen, removals mark it to be rebuilt on the next query
+    since a split can not be undone on a union-find. */
+  mutable std::vector<Vertex> parents;
+  mutable std::vector<uint32_t> sizes;
+  mutable bool components_outdated;
+  uint64_t components_generation;
+
+  // Bump the version after the pose or the history of the given edge changed
+  void touch(Edge const&);
 
   auto has_vertex(int64_t id) const -> bool;
   auto get_vertex(int64_t id) const -> Vertex;
   auto add_vertex(int64_t id) -> Vertex;
-  void remove_vertex(int64_t);
+  void remove_vertex(Vertex);
+
+  /* Validate and store the latest pose of an edge, adding it to the graph if needed. Returns
+    false, without changing anything, if the edge already had exactly the same pose. */
+  auto store(Edge const&, Pose const&) -> bool;
 
   void add_edge(Edge const&, float weight = 1.0);
   void remove_edge(Edge const&);
 
+  /* Run dijkstra to find the shortest path between the two given vertices, unless a shortest path
+    tree answers it, counting the runs on the given counter */
+  auto search_path(Edge const&, uint64_t& searched) const -> expected<Path, std::string>;
+  // Follow the predecessors from the given vertex until the root of the search is reached
+  auto walk_path(Edge const&, std::vector<Vertex> const& predecessors) const
+      -> expected<Path, std::string>;
+
+  void build_tree(int64_t root, Tree&, Vertex target) const;
+  /* Relax the tree from the vertices on the heap until no distance can be improved, or until
+    the target vertex is reached */
+  void propagate_tree(Tree&, std::vector<std::pair<float, Vertex>>& heap,
+                      Vertex target = FrameGraph::null_vertex()) const;
+  void tree_edge_added(Tree&, Vertex, Vertex, float weight) const;
+  void tree_edge_removed(Tree&, Vertex, Vertex) const;
+
+  auto find_component(Vertex) const -> Vertex;
+  void merge_components(Vertex, Vertex) const;
+  void rebuild_components() const;
+
  public:
-  FrameConversion() = default;
+  FrameConversion(Mode mode = Mode::General);
   FrameConversion(FrameConversion const&) = default;
   FrameConversion(FrameConversion&&) = default;
 
-  void update_transformation(Edge const&, common::Tensor const&);
+  /* Throws std::invalid_argument for loops (from == to), singular matrices or non rigid ones on
+    Mode::Rigid. Returns
+    false if the edge already had exactly the same pose, in which case nothing that depends only
+    on the latest poses (routes, compositions) needs to be recomputed. */
+  auto update_transformation(Edge const&, Pose const&) -> bool;
+  auto update_transformation(Edge const&, common::Tensor const&) -> bool;
   void remove_transformation(Edge const&);
 
-  void update_transformation(vision::FrameTransformation const&);
+  auto update_transformation(vision::FrameTransformation const&) -> bool;
   void remove_transformation(vision::FrameTransformation const&);
 
-  auto transformations() const -> std::unordered_map<Edge, common::Tensor, EdgeHash> const&;
+  /* Bulk version of update_transformation, meant to build the graph from many edges at once.
+    Shortest path trees are rebuilt once at the end instead of being updated after every edge.
+    Invalid transformations are skipped and returned along with the reason. */
+  auto update_transformations(std::vector<std::pair<Edge, Pose>> const&)
+      -> std::vector<std::pair<Edge, std::string>>;
+
+  /* Same as the ones before but also keeps the pose on the history of the edge, allowing it to
+    be looked up by time. See set_history_depth. */
+  auto update_transformation(Edge const&, Pose const&, Timestamp) -> bool;
+  auto update_transformation(vision::FrameTransformation const&, Timestamp) -> bool;
+
+  /* Number of timestamped poses kept for each edge, 1 (the default) keeps only the latest one.
+    Only applies to the histories created after the call. */
+  void set_history_depth(std::size_t depth);
+  auto pose_histories() const -> Histories const&;
+
+  auto transformations() const -> std::unordered_map<Edge, Pose, EdgeHash> const&;
+  auto conversion_mode() const -> Mode;
 
+  // Version of the transformations, changes on every update or removal
+  auto version() const -> uint64_t;
+  /* Edges, on sorted order, whose pose or history changed after the given version, repeated if
+    they changed more than once. Returns none if the version is too old for its changes to still
+    be known. */
+  auto changes_since(uint64_t version) const -> boost::optional<std::vector<Edge>>;
+  /* Version of the graph topology, changes only when edges are added or removed or when shortest
+    path trees are kept or dropped, i.e. whenever find_path may give a different route */
+  auto topology_version() const -> uint64_t;
+  // Number of find_path(Edge) calls answered by the route cache and by a new search
+  auto route_cache_hits() const -> uint64_t;
+  auto route_cache_misses() const -> uint64_t;
+  // Number of dijkstra runs, either to answer find_path or to build a shortest path tree
+  auto dijkstra_runs() const -> uint64_t;
+  // Number of transformations of single hops computed to be composed, see hop()
+  auto composed_hops() const -> uint64_t;
+  // Number of frames on the graph
+  auto num_frames() const -> std::size_t;
+
+  /* Keep a shortest path tree rooted at the given frame. Every path ending at it is then
+    answered by walking the tree instead of running a new search. The tree is updated
+    incrementally when edges are added or removed. */
+  void keep_tree(int64_t root);
+  void drop_tree(int64_t root);
+  auto keeps_tree(int64_t root) const -> bool;
+
+  /* Frame id that represents the connected component of the given frame, frames that are not on
+    the graph are a component of their own. Two frames are connected if and only if they have
+    the same representative. Representatives are stable until the next edge removal, except for
+    the components merged by the insertion of an edge. */
+  auto component(int64_t id) const -> int64_t;
+  // Changes whenever an edge is removed, invalidating the representatives given by component()
+  auto components_version() const -> uint64_t;
+
+  /* Copy of the state that find_path depends on: the graph, the shortest path trees and the route
+    cache, without any pose. It gives exactly the same routes as this one as long as the topology
+    version does not change. */
+  auto without_poses() const -> FrameConversion;
   // Try to find shortest path that connects the two given vertices
   auto find_path(Edge const&) const -> expected<Path, std::string>;
   // Try to find shortest path that connects all the vertices
   auto find_path(Path const&) const -> expected<Path, std::string>;
+  /* Same routes as find_path, but the route cache is only read, never filled, and nothing is
+    counted. Nothing is written at all, so any number of threads may call them at once as long as
+    no one modifies this FrameConversion. */
+  auto find_path_uncached(Edge const&) const -> expected<Path, std::string>;
+  auto find_path_uncached(Path const&) const -> expected<Path, std::string>;
+  // Inverse of a transformation, in closed form on Mode::Rigid
+  auto invert(Pose const&) const -> Pose;
+  // Transformation for a single hop of a path, inverting the stored edge if necessary
+  auto hop(int64_t from, int64_t to) const -> Pose;
   // Compose all the transformations on the given path resulting in a single transformation
+  auto compose(Path const&) const -> Pose;
+  // Same as compose but converted to its protobuf representation
   auto compose_path(Path const&) const -> common::Tensor;
+
+  /* Same as the ones before, but each hop is interpolated to its pose at the given time. Static
+    edges, updated without a timestamp, have the same pose at any time. */
+  auto hop(int64_t from, int64_t to, Timestamp) const -> Pose;
+  auto compose(Path const&, Timestamp) const -> Pose;
+  auto compose_path(Path const&, Timestamp) const -> common::Tensor;
 };
 
 }  // namespace is
\ No newline at end of file
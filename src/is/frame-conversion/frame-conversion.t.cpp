@@ -5,26 +5,10 @@
 #include <is/msgs/cv.hpp>
 #include <random>
 #include "frame-conversion.hpp"
+#include "test-support.hpp"
 
 namespace {
 
-auto create_random_tf_matrix() -> cv::Mat {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<> dist(0.0, 10.0);
-  auto rng = [&]() -> float { return dist(gen); };
-
-  // clang-format off
-  auto theta = rng();
-  return (cv::Mat_<double>(4, 4) 
-    << 1,               0,               0,  rng(), 
-       0, std::cos(theta), -std::sin(theta), rng(),
-       0, std::sin(theta), +std::cos(theta), rng(),
-       0,               0,                0,     1
-  );
-  // clang-format on
-}
-
 auto matrices_are_equal(cv::Mat const& l, cv::Mat const& r) -> bool {
   std::cout << l << std::endl;
   std::cout << r << std::endl;
@@ -36,9 +20,10 @@ auto matrices_are_equal(cv::Mat const& l, cv::Mat const& r) -> bool {
 }
 
 TEST(FrameConversion, Interface) {
-  auto cv1 = create_random_tf_matrix();
-  auto cv2 = create_random_tf_matrix();
-  auto cv3 = create_random_tf_matrix();
+  std::mt19937 gen(1);
+  auto cv1 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv2 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv3 = is::to_mat(is::to_tensor(is::random_pose(gen)));
 
   is::vision::FrameTransformation tf1;
   tf1.set_from(1000);
@@ -107,10 +92,10 @@ TEST(FrameConversion, Interface) {
   ASSERT_EQ(path.error(), "Frames \"1000\" and \"1002\" are not connected");
 
   // Test find_path with paths larger than 2 nodes
-  auto cv4 = create_random_tf_matrix();
-  auto cv5 = create_random_tf_matrix();
-  auto cv6 = create_random_tf_matrix();
-  auto cv7 = create_random_tf_matrix();
+  auto cv4 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv5 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv6 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv7 = is::to_mat(is::to_tensor(is::random_pose(gen)));
 
   is::vision::FrameTransformation tf4;
   tf4.set_from(1000);
@@ -131,9 +116,12 @@ TEST(FrameConversion, Interface) {
   conversions.update_transformation(tf5);
   conversions.update_transformation(tf6);
 
+  // Sending the same pose again changes nothing
+  ASSERT_FALSE(conversions.update_transformation(tf6));
+
   // Test transformation update, result should use new matrix
   *tf6.mutable_tf() = is::to_tensor(cv7);
-  conversions.update_transformation(tf6);
+  ASSERT_TRUE(conversions.update_transformation(tf6));
 
   /* Graph:
                     1004
@@ -157,9 +145,10 @@ TEST(FrameConversion, Interface) {
   // Remove transformations
   conversions.remove_transformation(tf6);  // Trying to remove twice should have no effect
   conversions.remove_transformation(tf6);
+  // 1004 has no other edges, hence it leaves the graph
   path = conversions.find_path(is::Path{1000, 2, 1004});
   ASSERT_FALSE(path);
-  ASSERT_EQ(path.error(), "Frames \"2\" and \"1004\" are not connected");
+  ASSERT_EQ(path.error(), "Invalid frame id \"1004\"");
 
   // Add the path again
   conversions.update_transformation(tf6);
@@ -167,4 +156,276 @@ TEST(FrameConversion, Interface) {
   ASSERT_TRUE(path);
 }
 
-}  // namespace
\ No newline at end of file
+TEST(FrameConversion, RigidMode) {
+  std::mt19937 gen(2);
+  auto cv1 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv2 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+
+  is::FrameConversion conversions{is::FrameConversion::Mode::Rigid};
+  conversions.update_transformation(is::Edge{1000, 1}, is::to_tensor(cv1));
+  conversions.update_transformation(is::Edge{1001, 1}, is::to_tensor(cv2));
+
+  // Each edge is stored once, the inverse is computed when walking it backwards
+  ASSERT_EQ(conversions.transformations().size(), 2u);
+  auto composed_tf = is::to_mat(conversions.compose_path(is::Path{1001, 1, 1000}));
+  ASSERT_TRUE(matrices_are_equal(composed_tf, cv1.inv() * cv2));
+
+  // Updating the opposite direction replaces the stored edge
+  conversions.update_transformation(is::Edge{1, 1000}, is::to_tensor(cv1.inv()));
+  ASSERT_EQ(conversions.transformations().size(), 2u);
+  composed_tf = is::to_mat(conversions.compose_path(is::Path{1001, 1, 1000}));
+  ASSERT_TRUE(matrices_are_equal(composed_tf, cv1.inv() * cv2));
+
+  // Walking a path backwards is the same as inverting its composition
+  auto backwards = conversions.compose(is::inverted(is::Path{1001, 1, 1000}));
+  auto inverted_tf = conversions.invert(conversions.compose(is::Path{1001, 1, 1000}));
+  ASSERT_TRUE(matrices_are_equal(is::to_mat(is::to_tensor(backwards)),
+                                 is::to_mat(is::to_tensor(inverted_tf))));
+
+  // Non rigid transformations are rejected
+  auto scaled = cv1.clone();
+  scaled.at<double>(0, 0) = 2.0;
+  ASSERT_THROW(conversions.update_transformation(is::Edge{1002, 1}, is::to_tensor(scaled)),
+               std::invalid_argument);
+  ASSERT_FALSE(conversions.find_path(is::Edge{1002, 1}));
+
+  // Singular matrices are rejected on every mode
+  is::FrameConversion general;
+  auto singular = is::to_tensor(cv::Mat::zeros(4, 4, CV_64F));
+  ASSERT_THROW(general.update_transformation(is::Edge{1002, 1}, singular), std::invalid_argument);
+}
+
+TEST(FrameConversion, RouteCache) {
+  std::mt19937 gen(3);
+  is::FrameConversion conversions;
+  conversions.update_transformation(is::Edge{1000, 1}, is::to_tensor(is::random_pose(gen)));
+  conversions.update_transformation(is::Edge{1001, 1}, is::to_tensor(is::random_pose(gen)));
+  auto topology = conversions.topology_version();
+
+  auto expected_path = is::Path{1001, 1, 1000};
+  ASSERT_EQ(*conversions.find_path(is::Edge{1001, 1000}), expected_path);
+  ASSERT_EQ(conversions.route_cache_misses(), 1u);
+  ASSERT_EQ(conversions.route_cache_hits(), 0u);
+  ASSERT_EQ(conversions.dijkstra_runs(), 1u);
+
+  // Updating the value of an existing edge keeps the topology, hence the cached route
+  conversions.update_transformation(is::Edge{1000, 1}, is::to_tensor(is::random_pose(gen)));
+  ASSERT_EQ(conversions.topology_version(), topology);
+  ASSERT_EQ(*conversions.find_path(is::Edge{1001, 1000}), expected_path);
+  ASSERT_EQ(conversions.route_cache_hits(), 1u);
+
+  // Unreachable routes are cached as well
+  ASSERT_FALSE(conversions.find_path(is::Edge{1001, 3000}));
+  ASSERT_FALSE(conversions.find_path(is::Edge{1001, 3000}));
+  ASSERT_EQ(conversions.route_cache_misses(), 2u);
+  ASSERT_EQ(conversions.route_cache_hits(), 2u);
+  // Unknown frames are rejected without searching
+  ASSERT_EQ(conversions.dijkstra_runs(), 1u);
+
+  // A new edge invalidates the cached routes
+  conversions.update_transformation(is::Edge{1001, 1000}, is::to_tensor(is::random_pose(gen)));
+  ASSERT_NE(conversions.topology_version(), topology);
+  expected_path = is::Path{1001, 1000};
+  ASSERT_EQ(*conversions.find_path(is::Edge{1001, 1000}), expected_path);
+  ASSERT_EQ(conversions.route_cache_misses(), 3u);
+
+  // and so does removing it
+  conversions.remove_transformation(is::Edge{1001, 1000});
+  expected_path = is::Path{1001, 1, 1000};
+  ASSERT_EQ(*conversions.find_path(is::Edge{1001, 1000}), expected_path);
+  ASSERT_EQ(conversions.route_cache_misses(), 4u);
+  ASSERT_EQ(conversions.dijkstra_runs(), 3u);
+
+  // Uncached lookups give the same routes without touching the cache or the counters
+  ASSERT_EQ(*conversions.find_path_uncached(is::Edge{1001, 1000}), expected_path);
+  ASSERT_EQ(*conversions.find_path_uncached(is::Edge{1000, 1001}), is::inverted(expected_path));
+  ASSERT_EQ(*conversions.find_path_uncached(is::Path{1001, 1000, 1}),
+            (is::Path{1001, 1, 1000, 1}));
+  ASSERT_EQ(conversions.route_cache_misses(), 4u);
+  ASSERT_EQ(conversions.route_cache_hits(), 2u);
+  ASSERT_EQ(conversions.dijkstra_runs(), 3u);
+
+  ASSERT_EQ(conversions.num_frames(), 3u);
+  auto hops = conversions.composed_hops();
+  conversions.compose(expected_path);
+  ASSERT_EQ(conversions.composed_hops(), hops + 2);
+}
+
+TEST(FrameConversion, ShortestPathTrees) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int64_t> frame(0, 30);
+  auto tensor = is::to_tensor(is::random_pose(gen));
+
+  // Same operations applied with and without trees, routes must have the same length
+  is::FrameConversion with_trees;
+  with_trees.keep_tree(0);
+  with_trees.keep_tree(7);
+  ASSERT_TRUE(with_trees.keeps_tree(7));
+  ASSERT_FALSE(with_trees.keeps_tree(1));
+  is::FrameConversion without_trees;
+
+  for (int i = 0; i < 500; ++i) {
+    auto edge = is::Edge{frame(gen), frame(gen)};
+    if (edge.from == edge.to) continue;
+    if (i % 3 == 0) {
+      with_trees.remove_transformation(edge);
+      without_trees.remove_transformation(edge);
+    } else {
+      with_trees.update_transformation(edge, tensor);
+      without_trees.update_transformation(edge, tensor);
+    }
+
+    for (int64_t from = 0; from <= 30; ++from) {
+      for (int64_t root : {0, 7}) {
+        auto expected_path = without_trees.find_path(is::Edge{from, root});
+        auto path = with_trees.find_path(is::Edge{from, root});
+        ASSERT_EQ(bool(path), bool(expected_path));
+        if (from != root) {
+          ASSERT_EQ(bool(path), with_trees.component(from) == with_trees.component(root));
+        }
+        if (path) {
+          ASSERT_EQ(path->size(), expected_path->size());
+          ASSERT_EQ(path->front(), from);
+          ASSERT_EQ(path->back(), root);
+          if (path->size() > 1) ASSERT_NO_THROW(with_trees.compose(*path));
+        }
+      }
+    }
+  }
+}
+
+TEST(FrameConversion, Components) {
+  std::mt19937 gen(4);
+  auto tensor = is::to_tensor(is::random_pose(gen));
+  is::FrameConversion conversions;
+  conversions.update_transformation(is::Edge{1000, 1}, tensor);
+  conversions.update_transformation(is::Edge{1001, 1}, tensor);
+  conversions.update_transformation(is::Edge{1002, 2}, tensor);
+  // Graph: 1000 <-> 1 <-> 1001     1002 <-> 2
+
+  ASSERT_EQ(conversions.component(1000), conversions.component(1001));
+  ASSERT_EQ(conversions.component(1002), conversions.component(2));
+  ASSERT_NE(conversions.component(1000), conversions.component(2));
+  ASSERT_EQ(conversions.component(3000), 3000);
+
+  // Insertions merge components without changing the version
+  auto version = conversions.components_version();
+  conversions.update_transformation(is::Edge{1, 2}, tensor);
+  ASSERT_EQ(conversions.components_version(), version);
+  ASSERT_EQ(conversions.component(1000), conversions.component(1002));
+
+  // Removals split them
+  conversions.remove_transformation(is::Edge{1, 2});
+  ASSERT_NE(conversions.components_version(), version);
+  ASSERT_EQ(conversions.component(1000), conversions.component(1001));
+  ASSERT_NE(conversions.component(1000), conversions.component(1002));
+
+  conversions.remove_transformation(is::Edge{1002, 2});
+  ASSERT_EQ(conversions.component(1002), 1002);
+}
+
+TEST(FrameConversion, SelfLoops) {
+  std::mt19937 gen(5);
+  auto tensor = is::to_tensor(is::random_pose(gen));
+  is::FrameConversion conversions;
+  conversions.update_transformation(is::Edge{1, 2}, tensor);
+  ASSERT_THROW(conversions.update_transformation(is::Edge{2, 2}, tensor), std::invalid_argument);
+  ASSERT_THROW(conversions.update_transformation(is::Edge{3, 3}, tensor), std::invalid_argument);
+  auto errors = conversions.update_transformations({{is::Edge{4, 4}, is::to_pose(tensor)}});
+  ASSERT_EQ(errors.size(), 1u);
+
+  // Removing the loop is a no-op, the frame slots must stay consistent
+  conversions.remove_transformation(is::Edge{2, 2});
+  conversions.remove_transformation(is::Edge{1, 2});
+  conversions.update_transformation(is::Edge{10, 11}, tensor);
+  conversions.update_transformation(is::Edge{12, 13}, tensor);
+
+  auto path = conversions.find_path(is::Edge{10, 11});
+  ASSERT_TRUE(path);
+  ASSERT_EQ(*path, (is::Path{10, 11}));
+  ASSERT_TRUE(conversions.find_path(is::Edge{12, 13}));
+  ASSERT_FALSE(conversions.find_path(is::Edge{10, 13}));
+  ASSERT_NE(conversions.component(10), conversions.component(12));
+}
+
+TEST(FrameConversion, BulkUpdate) {
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<int64_t> frame(0, 40);
+  auto transformations = std::vector<std::pair<is::Edge, is::Pose>>{};
+  for (int i = 0; i < 100; ++i) {
+    auto from = frame(gen);
+    auto to = frame(gen);
+    if (from != to) transformations.emplace_back(is::Edge{from, to}, is::Pose::identity());
+  }
+  auto singular = is::Pose::identity();
+  singular(2, 2) = 0.0;
+  transformations.emplace_back(is::Edge{0, 1000}, singular);
+
+  // Same graph as inserting the edges one by one
+  auto bulk = is::FrameConversion{};
+  bulk.keep_tree(0);
+  auto one_by_one = is::FrameConversion{};
+  one_by_one.keep_tree(0);
+  auto errors = bulk.update_transformations(transformations);
+  for (auto const& edge_and_pose : transformations) {
+    try {
+      one_by_one.update_transformation(edge_and_pose.first, edge_and_pose.second);
+    } catch (std::invalid_argument const&) {}
+  }
+
+  ASSERT_EQ(errors.size(), 1u);
+  ASSERT_TRUE(errors[0].first == (is::Edge{0, 1000}));
+  ASSERT_EQ(bulk.transformations().size(), one_by_one.transformations().size());
+  for (int64_t from = 0; from <= 40; ++from) {
+    auto l = bulk.find_path(is::Edge{from, 0});
+    auto r = one_by_one.find_path(is::Edge{from, 0});
+    ASSERT_EQ(bool(l), bool(r));
+    if (l) ASSERT_EQ(l->size(), r->size());
+    ASSERT_EQ(bulk.component(from) == bulk.component(0),
+              one_by_one.component(from) == one_by_one.component(0));
+  }
+}
+
+TEST(FrameConversion, History) {
+  auto rotation = [](double theta, double x) {
+    auto pose = is::Pose::identity();
+    pose(0, 0) = std::cos(theta);
+    pose(0, 1) = -std::sin(theta);
+    pose(1, 0) = std::sin(theta);
+    pose(1, 1) = std::cos(theta);
+    pose(0, 3) = x;
+    return pose;
+  };
+  auto t0 = is::FrameConversion::Timestamp{} + std::chrono::seconds(10);
+  auto t1 = t0 + std::chrono::seconds(1);
+  auto halfway = t0 + std::chrono::milliseconds(500);
+
+  auto conversions = is::FrameConversion{is::FrameConversion::Mode::Rigid};
+  conversions.set_history_depth(4);
+  // Static edge
+  conversions.update_transformation(is::Edge{0, 1000}, rotation(0.5, 1.0));
+  // Dynamic edge
+  conversions.update_transformation(is::Edge{100, 0}, rotation(0.0, 0.0), t0);
+  conversions.update_transformation(is::Edge{100, 0}, rotation(1.0, 2.0), t1);
+  ASSERT_EQ(conversions.pose_histories().size(), 1u);
+  ASSERT_EQ(conversions.pose_histories().at(is::Edge{100, 0}).size(), 2u);
+
+  auto expect_near = [](is::Pose const& l, is::Pose const& r) {
+    for (std::size_t i = 0; i < l.data.size(); ++i) { EXPECT_NEAR(l.data[i], r.data[i], 1e-9); }
+  };
+  // The latest pose is still the default
+  auto static_pose = rotation(0.5, 1.0);
+  expect_near(conversions.compose(is::Path{100, 0, 1000}), static_pose * rotation(1.0, 2.0));
+  // Halfway in time is halfway in rotation and translation
+  auto interpolated = static_pose * rotation(0.5, 1.0);
+  expect_near(conversions.compose(is::Path{100, 0, 1000}, halfway), interpolated);
+  // Also when walking the edges backwards
+  expect_near(conversions.compose(is::Path{1000, 0, 100}, halfway),
+              is::rigid_inverse(interpolated));
+
+  // Updating without a timestamp makes the edge static again
+  conversions.update_transformation(is::Edge{0, 100}, rotation(0.0, 0.0));
+  ASSERT_TRUE(conversions.pose_histories().empty());
+}
+
+}  // namespace
@@ -0,0 +1,134 @@
+#include "frame-graph.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace is {
+
+auto FrameGraph::null_vertex() -> Vertex {
+  return std::numeric_limits<Vertex>::max();
+}
+
+FrameGraph::FrameGraph() : wasted(0) {}
+
+auto FrameGraph::find_vertex(int64_t id) const -> Vertex {
+  auto it = index.find(id);
+  return it != index.end() ? it->second : null_vertex();
+}
+
+auto FrameGraph::id(Vertex vertex) const -> int64_t {
+  return ids[vertex];
+}
+
+auto FrameGraph::add_vertex(int64_t id) -> Vertex {
+  auto it = index.find(id);
+  if (it != index.end()) return it->second;
+
+  auto vertex = Vertex{};
+  if (!free_slots.empty()) {
+    vertex = free_slots.back();
+    free_slots.pop_back();
+    ids[vertex] = id;
+  } else {
+    if (slots.size() == null_vertex()) throw std::length_error{"Too many frames on the graph"};
+    vertex = static_cast<Vertex>(slots.size());
+    slots.push_back(Slot{0, 0, 0});
+    ids.push_back(id);
+  }
+  slots[vertex] = Slot{static_cast<uint32_t>(arcs_storage.size()), 0, 0};
+  index.emplace(id, vertex);
+  return vertex;
+}
+
+void FrameGraph::remove_vertex(Vertex vertex) {
+  auto& slot = slots[vertex];
+  auto first = arcs_storage.begin() + slot.offset;
+  for (auto it = first; it != first + slot.degree; ++it) { remove_arc(it->target, vertex); }
+
+  wasted += slot.capacity;
+  slot = Slot{0, 0, 0};
+  index.erase(ids[vertex]);
+  free_slots.push_back(vertex);
+  if (2 * wasted > arcs_storage.size()) compact();
+}
+
+void FrameGraph::add_edge(Vertex from, Vertex to, float weight) {
+  add_arc(from, to, weight);
+  add_arc(to, from, weight);
+}
+
+auto FrameGraph::remove_edge(Vertex from, Vertex to) -> bool {
+  auto removed = remove_arc(from, to) && remove_arc(to, from);
+  if (2 * wasted > arcs_storage.size()) compact();
+  return removed;
+}
+
+void FrameGraph::add_arc(Vertex from, Vertex to, float weight) {
+  auto& slot = slots[from];
+  if (slot.degree == slot.capacity) {
+    auto capacity = std::max<uint32_t>(4, 2 * slot.capacity);
+    if (slot.offset + slot.capacity == arcs_storage.size()) {
+      // Block is already at the end of the array, grow it in place
+      arcs_storage.resize(slot.offset + capacity);
+    } else {
+      auto offset = static_cast<uint32_t>(arcs_storage.size());
+      arcs_storage.resize(offset + capacity);
+      std::copy(arcs_storage.begin() + slot.offset,
+                arcs_storage.begin() + slot.offset + slot.degree,
+                arcs_storage.begin() + offset);
+      wasted += slot.capacity;
+      slot.offset = offset;
+    }
+    slot.capacity = capacity;
+  }
+  arcs_storage[slot.offset + slot.degree] = Arc{to, weight};
+  ++slot.degree;
+}
+
+auto FrameGraph::remove_arc(Vertex from, Vertex to) -> bool {
+  auto& slot = slots[from];
+  auto first = arcs_storage.begin() + slot.offset;
+  auto last = first + slot.degree;
+  auto it = std::find_if(first, last, [to](Arc const& arc) { return arc.target == to; });
+  if (it == last) return false;
+  *it = *(last - 1);
+  --slot.degree;
+  return true;
+}
+
+auto FrameGraph::arcs(Vertex vertex) const -> Arcs {
+  auto const& slot = slots[vertex];
+  auto first = arcs_storage.data() + slot.offset;
+  return Arcs{first, first + slot.degree};
+}
+
+auto FrameGraph::degree(Vertex vertex) const -> uint32_t {
+  return slots[vertex].degree;
+}
+
+auto FrameGraph::num_vertices() const -> std::size_t {
+  return slots.size();
+}
+
+auto FrameGraph::size() const -> std::size_t {
+  return index.size();
+}
+
+void FrameGraph::compact() {
+  auto n_arcs = std::size_t{0};
+  for (auto const& slot : slots) { n_arcs += slot.degree; }
+
+  auto compacted = std::vector<Arc>{};
+  compacted.reserve(n_arcs);
+  for (auto& slot : slots) {
+    auto offset = static_cast<uint32_t>(compacted.size());
+    compacted.insert(compacted.end(), arcs_storage.begin() + slot.offset,
+                     arcs_storage.begin() + slot.offset + slot.degree);
+    slot.offset = offset;
+    slot.capacity = slot.degree;
+  }
+  arcs_storage.swap(compacted);
+  wasted = 0;
+}
+
+}  // namespace is
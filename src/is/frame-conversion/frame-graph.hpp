@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace is {
+
+/* Undirected weighted graph of frames stored as a compressed adjacency array (CSR) with slack.
+  External int64 frame ids are mapped to dense 32-bit vertices, whose slots are recycled when
+  frames are removed. The arcs of every vertex live on a contiguous block of a single array,
+  blocks that run out of capacity are moved to its end and the holes they leave behind are
+  reclaimed by compact(). */
+class FrameGraph {
+ public:
+  using Vertex = uint32_t;
+
+  struct Arc {
+    Vertex target;
+    float weight;
+  };
+
+  // Range over the arcs leaving a vertex
+  struct Arcs {
+    Arc const* first;
+    Arc const* last;
+    auto begin() const -> Arc const* { return first; }
+    auto end() const -> Arc const* { return last; }
+  };
+
+  static auto null_vertex() -> Vertex;
+
+ private:
+  struct Slot {
+    uint32_t offset;
+    uint32_t degree;
+    uint32_t capacity;
+  };
+
+  std::vector<Arc> arcs_storage;
+  std::vector<Slot> slots;
+  std::vector<int64_t> ids;
+  std::unordered_map<int64_t, Vertex> index;
+  // Vertices removed whose slots can be reused
+  std::vector<Vertex> free_slots;
+  // Number of positions of arcs_storage that belong to no vertex
+  std::size_t wasted;
+
+  void add_arc(Vertex from, Vertex to, float weight);
+  auto remove_arc(Vertex from, Vertex to) -> bool;
+
+ public:
+  FrameGraph();
+
+  // Vertex of the given frame id or null_vertex() if the frame is not on the graph
+  auto find_vertex(int64_t id) const -> Vertex;
+  auto id(Vertex) const -> int64_t;
+  // Add the frame if it is not on the graph yet, returning its vertex either way
+  auto add_vertex(int64_t id) -> Vertex;
+  // Remove the vertex along with all the edges connected to it
+  void remove_vertex(Vertex);
+
+  void add_edge(Vertex, Vertex, float weight = 1.0);
+  auto remove_edge(Vertex, Vertex) -> bool;
+
+  auto arcs(Vertex) const -> Arcs;
+  auto degree(Vertex) const -> uint32_t;
+
+  // Upper bound of the vertex ids currently in use, i.e. the size of any per vertex array
+  auto num_vertices() const -> std::size_t;
+  // Number of frames on the graph
+  auto size() const -> std::size_t;
+
+  // Rewrite the adjacency array without holes
+  void compact();
+};
+
+}  // namespace is
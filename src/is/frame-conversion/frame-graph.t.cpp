@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include "frame-graph.hpp"
+
+namespace {
+
+auto neighbors(is::FrameGraph const& graph, int64_t id) -> std::set<int64_t> {
+  auto ids = std::set<int64_t>{};
+  for (auto const& arc : graph.arcs(graph.find_vertex(id))) { ids.insert(graph.id(arc.target)); }
+  return ids;
+}
+
+TEST(FrameGraph, Interface) {
+  is::FrameGraph graph;
+  auto v1000 = graph.add_vertex(1000);
+  auto v1 = graph.add_vertex(1);
+  ASSERT_EQ(graph.add_vertex(1000), v1000);
+  ASSERT_EQ(graph.find_vertex(1000), v1000);
+  ASSERT_EQ(graph.find_vertex(3000), is::FrameGraph::null_vertex());
+  ASSERT_EQ(graph.id(v1), 1);
+
+  graph.add_edge(v1000, v1);
+  ASSERT_EQ(neighbors(graph, 1000), std::set<int64_t>{1});
+  ASSERT_EQ(neighbors(graph, 1), std::set<int64_t>{1000});
+
+  // Removing a vertex removes its edges and frees its slot for the next frame
+  graph.remove_vertex(v1);
+  ASSERT_EQ(graph.find_vertex(1), is::FrameGraph::null_vertex());
+  ASSERT_EQ(graph.degree(v1000), 0u);
+  ASSERT_EQ(graph.size(), 1u);
+  ASSERT_EQ(graph.add_vertex(1001), v1);
+  ASSERT_EQ(graph.num_vertices(), 2u);
+
+  ASSERT_FALSE(graph.remove_edge(v1000, v1));
+}
+
+TEST(FrameGraph, RandomOperations) {
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int64_t> frame(0, 50);
+
+  // Reference adjacency to compare with
+  auto reference = std::set<std::pair<int64_t, int64_t>>{};
+  is::FrameGraph graph;
+
+  for (int i = 0; i < 5000; ++i) {
+    auto from = frame(gen);
+    auto to = frame(gen);
+    if (from == to) continue;
+    auto key = std::make_pair(std::min(from, to), std::max(from, to));
+
+    if (i % 7 == 0) {
+      // Remove a whole frame
+      auto vertex = graph.find_vertex(from);
+      if (vertex == is::FrameGraph::null_vertex()) continue;
+      graph.remove_vertex(vertex);
+      for (auto it = reference.begin(); it != reference.end();) {
+        it = (it->first == from || it->second == from) ? reference.erase(it) : std::next(it);
+      }
+    } else if (reference.count(key)) {
+      ASSERT_TRUE(graph.remove_edge(graph.find_vertex(from), graph.find_vertex(to)));
+      reference.erase(key);
+    } else {
+      graph.add_edge(graph.add_vertex(from), graph.add_vertex(to));
+      reference.insert(key);
+    }
+  }
+
+  graph.compact();
+  for (int64_t id = 0; id <= 50; ++id) {
+    if (graph.find_vertex(id) == is::FrameGraph::null_vertex()) continue;
+    auto expected = std::set<int64_t>{};
+    for (auto const& edge : reference) {
+      if (edge.first == id) expected.insert(edge.second);
+      if (edge.second == id) expected.insert(edge.first);
+    }
+    ASSERT_EQ(neighbors(graph, id), expected);
+  }
+  ASSERT_LE(graph.num_vertices(), 51u);
+}
+
+}  // namespace
@@ -0,0 +1,177 @@
+#include "frame-snapshot.hpp"
+#include <stdexcept>
+
+namespace is {
+
+// Average number of edges per chunk on a new snapshot, the chunks are rebuilt at 4 times that
+static constexpr std::size_t chunk_edges = 16;
+
+static auto chunk_index(Edge const& edge, std::size_t n_chunks) -> std::size_t {
+  return EdgeHash{}(sorted(edge)) & (n_chunks - 1);
+}
+
+// Bring the copy of a chunk up to date with the current pose and history of the given edge
+static void refresh(FrameSnapshot::Chunk& chunk, Edge const& edge,
+                    FrameConversion const& conversions) {
+  // The edge may have been given again on the opposite direction
+  chunk.poses.erase(edge);
+  chunk.poses.erase(inverted(edge));
+  chunk.histories.erase(edge);
+  chunk.histories.erase(inverted(edge));
+
+  for (auto const& direction : {edge, inverted(edge)}) {
+    auto pose = conversions.transformations().find(direction);
+    if (pose != conversions.transformations().end()) chunk.poses.emplace(direction, pose->second);
+    auto history = conversions.pose_histories().find(direction);
+    if (history != conversions.pose_histories().end()) {
+      chunk.histories.emplace(direction, history->second);
+    }
+  }
+}
+
+static auto build_chunks(FrameConversion const& conversions) -> FrameSnapshot::Chunks {
+  auto n_chunks = std::size_t{16};
+  while (n_chunks * chunk_edges < conversions.transformations().size()) n_chunks *= 2;
+
+  auto built = std::vector<std::shared_ptr<FrameSnapshot::Chunk>>{};
+  built.reserve(n_chunks);
+  for (std::size_t i = 0; i < n_chunks; ++i) {
+    built.push_back(std::make_shared<FrameSnapshot::Chunk>());
+  }
+  for (auto const& edge_and_pose : conversions.transformations()) {
+    built[chunk_index(edge_and_pose.first, n_chunks)]->poses.insert(edge_and_pose);
+  }
+  for (auto const& edge_and_history : conversions.pose_histories()) {
+    built[chunk_index(edge_and_history.first, n_chunks)]->histories.insert(edge_and_history);
+  }
+  return FrameSnapshot::Chunks(built.begin(), built.end());
+}
+
+FrameSnapshot::FrameSnapshot(FrameConversion::Mode m, uint64_t version, std::size_t size,
+                             Chunks c, std::shared_ptr<Topology const> t)
+    : mode(m),
+      poses_version(version),
+      n_transformations(size),
+      chunks(std::move(c)),
+      topology(std::move(t)) {}
+
+auto FrameSnapshot::create(FrameConversion const& conversions,
+                           std::shared_ptr<FrameSnapshot const> const& previous)
+    -> std::shared_ptr<FrameSnapshot const> {
+  if (previous && previous->version() == conversions.version()) return previous;
+
+  auto topology = std::shared_ptr<Topology const>{};
+  if (previous && previous->topology_version() == conversions.topology_version()) {
+    topology = previous->topology;
+  } else {
+    topology = std::make_shared<Topology const>(conversions.without_poses());
+  }
+
+  auto size = conversions.transformations().size();
+  auto changes = previous ? conversions.changes_since(previous->version())
+                          : boost::optional<std::vector<Edge>>{};
+  // Start over if the changes are unknown or the chunks grew too large to be copied cheaply
+  if (!changes || size > 4 * chunk_edges * previous->chunks.size()) {
+    return std::make_shared<FrameSnapshot>(conversions.conversion_mode(), conversions.version(),
+                                           size, build_chunks(conversions), topology);
+  }
+
+  auto chunks = previous->chunks;
+  auto copies = std::vector<std::shared_ptr<Chunk>>(chunks.size());
+  for (auto const& edge : *changes) {
+    auto index = chunk_index(edge, chunks.size());
+    if (!copies[index]) {
+      copies[index] = std::make_shared<Chunk>(*chunks[index]);
+      chunks[index] = copies[index];
+    }
+    refresh(*copies[index], edge, conversions);
+  }
+  return std::make_shared<FrameSnapshot>(conversions.conversion_mode(), conversions.version(),
+                                         size, std::move(chunks), topology);
+}
+
+auto FrameSnapshot::chunk(Edge const& edge) const -> Chunk const& {
+  return *chunks[chunk_index(edge, chunks.size())];
+}
+
+auto FrameSnapshot::version() const -> uint64_t {
+  return poses_version;
+}
+
+auto FrameSnapshot::topology_version() const -> uint64_t {
+  return topology->topology_version();
+}
+
+auto FrameSnapshot::size() const -> std::size_t {
+  return n_transformations;
+}
+
+auto FrameSnapshot::pose_chunks() const -> Chunks const& {
+  return chunks;
+}
+
+auto FrameSnapshot::find_path(Edge const& edge) const -> expected<Path, std::string> {
+  return topology->find_path_uncached(edge);
+}
+
+auto FrameSnapshot::find_path(Path const& path) const -> expected<Path, std::string> {
+  return topology->find_path_uncached(path);
+}
+
+auto FrameSnapshot::hop(int64_t from, int64_t to) const -> Pose {
+  auto const& poses = chunk(Edge{from, to}).poses;
+  auto forward = poses.find(Edge{from, to});
+  if (forward != poses.end()) return forward->second;
+
+  auto backward = poses.find(Edge{to, from});
+  if (backward == poses.end()) {
+    throw std::logic_error{"Transformation exists but no pose found"};
+  }
+  return mode == FrameConversion::Mode::Rigid ? rigid_inverse(backward->second)
+                                              : inverse(backward->second);
+}
+
+auto FrameSnapshot::compose(Path const& path) const -> Pose {
+  if (path.size() < 2) {
+    throw std::invalid_argument{"A transformation path must contain atleast 2 ids"};
+  }
+
+  auto tf = Pose::identity();
+  for (auto it = path.begin() + 1; it != path.end(); ++it) { tf = hop(*(it - 1), *it) * tf; }
+  return tf;
+}
+
+auto FrameSnapshot::compose_path(Path const& path) const -> common::Tensor {
+  return to_tensor(compose(path));
+}
+
+auto FrameSnapshot::hop(int64_t from, int64_t to, FrameConversion::Timestamp stamp) const
+    -> Pose {
+  auto const& histories = chunk(Edge{from, to}).histories;
+  auto forward = histories.find(Edge{from, to});
+  if (forward != histories.end()) return forward->second.at(stamp);
+
+  auto backward = histories.find(Edge{to, from});
+  if (backward == histories.end()) return hop(from, to);
+  auto pose = backward->second.at(stamp);
+  return mode == FrameConversion::Mode::Rigid ? rigid_inverse(pose) : inverse(pose);
+}
+
+auto FrameSnapshot::compose(Path const& path, FrameConversion::Timestamp stamp) const -> Pose {
+  if (path.size() < 2) {
+    throw std::invalid_argument{"A transformation path must contain atleast 2 ids"};
+  }
+
+  auto tf = Pose::identity();
+  for (auto it = path.begin() + 1; it != path.end(); ++it) {
+    tf = hop(*(it - 1), *it, stamp) * tf;
+  }
+  return tf;
+}
+
+auto FrameSnapshot::compose_path(Path const& path, FrameConversion::Timestamp stamp) const
+    -> common::Tensor {
+  return to_tensor(compose(path, stamp));
+}
+
+}  // namespace is
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "frame-conversion.hpp"
+
+namespace is {
+
+/* Immutable view of a FrameConversion at a given version. A snapshot is never modified after it
+  is created, so any number of threads can query it without locking while the FrameConversion
+  keeps being updated by its own thread. Consecutive snapshots share the topology as long as it
+  did not change, and every chunk of the poses that none of the updates in between touched. */
+class FrameSnapshot {
+ public:
+  /* Poses and histories of the edges that fall on the same chunk, by the hash of their sorted
+    frames. A new snapshot copies only the chunks with an edge that changed since the previous
+    one, so its cost follows the size of the update instead of the size of the graph. */
+  struct Chunk {
+    std::unordered_map<Edge, Pose, EdgeHash> poses;
+    FrameConversion::Histories histories;
+  };
+  using Chunks = std::vector<std::shared_ptr<Chunk const>>;
+  /* Routing state of the FrameConversion at the time of the snapshot: its graph, shortest path
+    trees and route cache, frozen. Routes are looked up with find_path_uncached, which never
+    writes to it, so the routes match the published ones without any lock. */
+  using Topology = FrameConversion;
+
+ private:
+  FrameConversion::Mode mode;
+  uint64_t poses_version;
+  std::size_t n_transformations;
+  // Power of two number of chunks, so the hash of an edge is masked to find its chunk
+  Chunks chunks;
+  std::shared_ptr<Topology const> topology;
+
+  // Chunk that holds the pose and the history of the given edge, on either direction
+  auto chunk(Edge const&) const -> Chunk const&;
+
+ public:
+  FrameSnapshot(FrameConversion::Mode mode, uint64_t version, std::size_t size, Chunks chunks,
+                std::shared_ptr<Topology const> topology);
+
+  /* Snapshot of the current state of the given FrameConversion, reusing the parts of the
+    previous snapshot that are still up to date. Returns the previous one if nothing changed. */
+  static auto create(FrameConversion const&,
+                     std::shared_ptr<FrameSnapshot const> const& previous = nullptr)
+      -> std::shared_ptr<FrameSnapshot const>;
+
+  // Same as FrameConversion::version and topology_version at the time of the snapshot
+  auto version() const -> uint64_t;
+  auto topology_version() const -> uint64_t;
+  // Number of transformations on the snapshot
+  auto size() const -> std::size_t;
+  // Chunks of the poses, the ones that did not change are shared with the previous snapshot
+  auto pose_chunks() const -> Chunks const&;
+
+  /* Same as the FrameConversion ones. Routes are the ones the FrameConversion gave, or would give,
+    at the time of the snapshot. */
+  auto find_path(Edge const&) const -> expected<Path, std::string>;
+  auto find_path(Path const&) const -> expected<Path, std::string>;
+  auto hop(int64_t from, int64_t to) const -> Pose;
+  auto compose(Path const&) const -> Pose;
+  auto compose_path(Path const&) const -> common::Tensor;
+  auto hop(int64_t from, int64_t to, FrameConversion::Timestamp) const -> Pose;
+  auto compose(Path const&, FrameConversion::Timestamp) const -> Pose;
+  auto compose_path(Path const&, FrameConversion::Timestamp) const -> common::Tensor;
+};
+
+}  // namespace is
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include "frame-snapshot.hpp"
+#include "test-expectations.hpp"
+#include "test-support.hpp"
+
+namespace {
+
+TEST(FrameSnapshot, Interface) {
+  std::mt19937 gen(5);
+  auto conversions = is::FrameConversion{is::FrameConversion::Mode::Rigid};
+  conversions.update_transformation(is::Edge{100, 0}, is::random_pose(gen));
+  conversions.update_transformation(is::Edge{0, 1000}, is::random_pose(gen));
+
+  auto first = is::FrameSnapshot::create(conversions);
+  ASSERT_EQ(first->version(), conversions.version());
+  ASSERT_EQ(*first->find_path(is::Edge{1000, 100}), (is::Path{1000, 0, 100}));
+  ASSERT_EQ(*first->find_path(is::Path{100, 1000, 0}), (is::Path{100, 0, 1000, 0}));
+  ASSERT_FALSE(first->find_path(is::Edge{100, 1004}));
+  is::expect_equal(first->compose(is::Path{1000, 0, 100}),
+                   conversions.compose(is::Path{1000, 0, 100}));
+
+  // Nothing changed, the same snapshot is reused
+  ASSERT_EQ(is::FrameSnapshot::create(conversions, first), first);
+
+  // Updating a pose keeps the topology but not the poses
+  auto old_pose = first->compose(is::Path{100, 0});
+  conversions.update_transformation(is::Edge{100, 0}, is::random_pose(gen));
+  auto second = is::FrameSnapshot::create(conversions, first);
+  ASSERT_EQ(second->topology_version(), first->topology_version());
+  is::expect_equal(first->compose(is::Path{100, 0}), old_pose);
+  is::expect_equal(second->compose(is::Path{100, 0}), conversions.compose(is::Path{100, 0}));
+
+  // Removing an edge leaves the older snapshots untouched
+  conversions.remove_transformation(is::Edge{0, 1000});
+  auto third = is::FrameSnapshot::create(conversions, second);
+  ASSERT_NE(third->topology_version(), second->topology_version());
+  ASSERT_FALSE(third->find_path(is::Edge{100, 1000}));
+  ASSERT_TRUE(second->find_path(is::Edge{100, 1000}));
+}
+
+TEST(FrameSnapshot, SharedChunks) {
+  std::mt19937 gen(3);
+  auto conversions = is::FrameConversion{is::FrameConversion::Mode::Rigid};
+  conversions.set_history_depth(4);
+  for (int64_t i = 1; i < 1000; ++i) {
+    conversions.update_transformation(is::Edge{i - 1, i}, is::random_pose(gen), is::seconds(i));
+  }
+  auto first = is::FrameSnapshot::create(conversions);
+  ASSERT_EQ(first->size(), 999u);
+  auto old_pose = first->compose(is::Path{499, 500}, is::seconds(500));
+
+  // A single update copies a single chunk, the others are shared with the previous snapshot
+  conversions.update_transformation(is::Edge{500, 499}, is::random_pose(gen), is::seconds(1000));
+  auto second = is::FrameSnapshot::create(conversions, first);
+  auto const& before = first->pose_chunks();
+  auto const& after = second->pose_chunks();
+  ASSERT_EQ(before.size(), after.size());
+  auto copied = 0;
+  for (std::size_t i = 0; i < before.size(); ++i) { copied += before[i] != after[i]; }
+  ASSERT_EQ(copied, 1);
+
+  // Given on the opposite direction, the edge replaced the old pose and history
+  is::expect_equal(second->compose(is::Path{499, 500}), conversions.compose(is::Path{499, 500}));
+  is::expect_equal(second->compose(is::Path{499, 500}, is::seconds(500)),
+                   conversions.compose(is::Path{499, 500}, is::seconds(500)));
+  is::expect_equal(first->compose(is::Path{499, 500}, is::seconds(500)), old_pose);
+  auto route = *second->find_path(is::Edge{0, 999});
+  is::expect_equal(second->compose(route, is::seconds(900)),
+                   conversions.compose(route, is::seconds(900)));
+
+  conversions.remove_transformation(is::Edge{998, 999});
+  auto third = is::FrameSnapshot::create(conversions, second);
+  ASSERT_EQ(third->size(), 998u);
+  ASSERT_FALSE(third->find_path(is::Edge{0, 999}));
+  ASSERT_TRUE(second->find_path(is::Edge{0, 999}));
+
+  // Too many changes since the previous snapshot to be known, it is built from scratch
+  for (int i = 0; i < 5000; ++i) {
+    conversions.update_transformation(is::Edge{i % 998, i % 998 + 1}, is::random_pose(gen));
+  }
+  ASSERT_FALSE(conversions.changes_since(third->version()));
+  auto fourth = is::FrameSnapshot::create(conversions, third);
+  route = *fourth->find_path(is::Edge{0, 998});
+  is::expect_equal(fourth->compose(route), conversions.compose(route));
+}
+
+TEST(FrameSnapshot, SameRoutes) {
+  // Grid of 6x6 frames, with many shortest paths of the same length between most frames
+  std::mt19937 gen(13);
+  std::uniform_int_distribution<int64_t> frame(0, 35);
+  auto conversions = is::FrameConversion{is::FrameConversion::Mode::Rigid};
+  conversions.keep_tree(0);
+  auto snapshot = is::FrameSnapshot::create(conversions);
+
+  for (int i = 0; i < 200; ++i) {
+    auto from = frame(gen);
+    auto to = i % 2 ? from + 1 : from + 6;
+    if (to > 35 || (i % 2 && to % 6 == 0)) continue;
+    if (i % 5 == 0) {
+      conversions.remove_transformation(is::Edge{from, to});
+    } else {
+      conversions.update_transformation(is::Edge{from, to}, is::random_pose(gen));
+    }
+    if (i == 100) conversions.keep_tree(21);
+    snapshot = is::FrameSnapshot::create(conversions, snapshot);
+
+    // Routes must match whichever is asked first
+    for (int64_t a = 0; a <= 35; ++a) {
+      for (int64_t b = 0; b <= 35; b += 7) {
+        auto edge = i % 3 ? is::Edge{a, b} : is::Edge{b, a};
+        auto route = snapshot->find_path(edge);
+        auto expected_route = conversions.find_path(edge);
+        ASSERT_EQ(bool(route), bool(expected_route));
+        if (route) ASSERT_EQ(*route, *expected_route);
+      }
+    }
+  }
+}
+
+TEST(FrameSnapshot, ConcurrentReaders) {
+  std::mt19937 gen(11);
+  auto conversions = is::FrameConversion{};
+  for (int64_t i = 1; i < 20; ++i) {
+    conversions.update_transformation(is::Edge{i - 1, i}, is::random_pose(gen));
+  }
+  auto snapshot = is::FrameSnapshot::create(conversions);
+  auto expected = snapshot->compose(*snapshot->find_path(is::Edge{19, 0}));
+
+  auto readers = std::vector<std::thread>{};
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      for (int j = 0; j < 200; ++j) {
+        is::expect_equal(snapshot->compose(*snapshot->find_path(is::Edge{19, 0})), expected);
+      }
+    });
+  }
+  // The writer keeps going while the snapshot is being read
+  for (int64_t i = 1; i < 20; ++i) {
+    conversions.update_transformation(is::Edge{i - 1, i}, is::random_pose(gen));
+  }
+  for (auto& reader : readers) { reader.join(); }
+}
+
+}  // namespace
@@ -0,0 +1,125 @@
+#include "points.hpp"
+
+namespace is {
+
+namespace {
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+// One clone per instruction set, resolved once by the dynamic loader
+#define IS_POINTS_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#define IS_POINTS_INLINE inline __attribute__((always_inline))
+#else
+#define IS_POINTS_KERNEL
+#define IS_POINTS_INLINE inline
+#endif
+
+// First three rows of an affine transformation, converted once to the type of the points
+template <typename T>
+struct Affine {
+  T r00, r01, r02, tx;
+  T r10, r11, r12, ty;
+  T r20, r21, r22, tz;
+
+  // clang-format off
+  explicit Affine(Pose const& p)
+      : r00(T(p(0, 0))), r01(T(p(0, 1))), r02(T(p(0, 2))), tx(T(p(0, 3))),
+        r10(T(p(1, 0))), r11(T(p(1, 1))), r12(T(p(1, 2))), ty(T(p(1, 3))),
+        r20(T(p(2, 0))), r21(T(p(2, 1))), r22(T(p(2, 2))), tz(T(p(2, 3))) {}
+  // clang-format on
+};
+
+/* Plain loops without branches nor aliasing, written for the compiler to vectorize on each
+  instruction set the kernels are cloned for */
+template <typename T>
+IS_POINTS_INLINE void affine_soa(Affine<T> const& a, T* __restrict x, T* __restrict y,
+                                 T* __restrict z, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    auto px = x[i], py = y[i], pz = z[i];
+    x[i] = a.r00 * px + a.r01 * py + a.r02 * pz + a.tx;
+    y[i] = a.r10 * px + a.r11 * py + a.r12 * pz + a.ty;
+    z[i] = a.r20 * px + a.r21 * py + a.r22 * pz + a.tz;
+  }
+}
+
+template <typename T>
+IS_POINTS_INLINE void affine_aos(Affine<T> const& a, T* __restrict xyz, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    auto p = xyz + 3 * i;
+    auto px = p[0], py = p[1], pz = p[2];
+    p[0] = a.r00 * px + a.r01 * py + a.r02 * pz + a.tx;
+    p[1] = a.r10 * px + a.r11 * py + a.r12 * pz + a.ty;
+    p[2] = a.r20 * px + a.r21 * py + a.r22 * pz + a.tz;
+  }
+}
+
+IS_POINTS_KERNEL void kernel_soa(Affine<double> const& a, double* x, double* y, double* z,
+                                 std::size_t n) {
+  affine_soa(a, x, y, z, n);
+}
+
+IS_POINTS_KERNEL void kernel_soa(Affine<float> const& a, float* x, float* y, float* z,
+                                 std::size_t n) {
+  affine_soa(a, x, y, z, n);
+}
+
+IS_POINTS_KERNEL void kernel_aos(Affine<double> const& a, double* xyz, std::size_t n) {
+  affine_aos(a, xyz, n);
+}
+
+IS_POINTS_KERNEL void kernel_aos(Affine<float> const& a, float* xyz, std::size_t n) {
+  affine_aos(a, xyz, n);
+}
+
+auto is_affine(Pose const& p) -> bool {
+  return p(3, 0) == 0.0 && p(3, 1) == 0.0 && p(3, 2) == 0.0 && p(3, 3) == 1.0;
+}
+
+// Only for the general transformations that are not affine, which need the perspective division
+template <typename T>
+void projective(Pose const& p, T* x, T* y, T* z, std::size_t stride, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i, x += stride, y += stride, z += stride) {
+    auto px = double(*x), py = double(*y), pz = double(*z);
+    auto w = p(3, 0) * px + p(3, 1) * py + p(3, 2) * pz + p(3, 3);
+    *x = T((p(0, 0) * px + p(0, 1) * py + p(0, 2) * pz + p(0, 3)) / w);
+    *y = T((p(1, 0) * px + p(1, 1) * py + p(1, 2) * pz + p(1, 3)) / w);
+    *z = T((p(2, 0) * px + p(2, 1) * py + p(2, 2) * pz + p(2, 3)) / w);
+  }
+}
+
+template <typename T>
+void transform_interleaved(Pose const& pose, T* xyz, std::size_t n) {
+  if (is_affine(pose)) {
+    kernel_aos(Affine<T>{pose}, xyz, n);
+  } else {
+    projective(pose, xyz, xyz + 1, xyz + 2, 3, n);
+  }
+}
+
+template <typename T>
+void transform_separate(Pose const& pose, T* x, T* y, T* z, std::size_t n) {
+  if (is_affine(pose)) {
+    kernel_soa(Affine<T>{pose}, x, y, z, n);
+  } else {
+    projective(pose, x, y, z, 1, n);
+  }
+}
+
+}  // namespace
+
+void transform_points(Pose const& pose, double* xyz, std::size_t n) {
+  transform_interleaved(pose, xyz, n);
+}
+
+void transform_points(Pose const& pose, float* xyz, std::size_t n) {
+  transform_interleaved(pose, xyz, n);
+}
+
+void transform_points(Pose const& pose, double* x, double* y, double* z, std::size_t n) {
+  transform_separate(pose, x, y, z, n);
+}
+
+void transform_points(Pose const& pose, float* x, float* y, float* z, std::size_t n) {
+  transform_separate(pose, x, y, z, n);
+}
+
+}  // namespace is
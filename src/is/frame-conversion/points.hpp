@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include "pose.hpp"
+
+namespace is {
+
+/* Bulk application of a transformation to 3D points, e.g. skeletons or point clouds given on a
+  frame and wanted on another one: compose the path between the two frames and pass the result.
+  Points are transformed in place, either interleaved (x0 y0 z0 x1 y1 z1 ...) or on separate
+  coordinate arrays, which must not overlap. On x86-64 the kernels are compiled for AVX-512, AVX2
+  and the baseline instruction set, and the best one the CPU supports is picked when the library
+  is loaded. */
+void transform_points(Pose const&, double* xyz, std::size_t n);
+void transform_points(Pose const&, float* xyz, std::size_t n);
+void transform_points(Pose const&, double* x, double* y, double* z, std::size_t n);
+void transform_points(Pose const&, float* x, float* y, float* z, std::size_t n);
+
+}  // namespace is
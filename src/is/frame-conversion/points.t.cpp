@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "points.hpp"
+#include "test-support.hpp"
+
+namespace {
+
+// Reference result, the full homogeneous product
+auto transform(is::Pose const& p, double x, double y, double z) -> std::vector<double> {
+  auto w = p(3, 0) * x + p(3, 1) * y + p(3, 2) * z + p(3, 3);
+  auto result = std::vector<double>{};
+  for (int row = 0; row < 3; ++row) {
+    result.push_back((p(row, 0) * x + p(row, 1) * y + p(row, 2) * z + p(row, 3)) / w);
+  }
+  return result;
+}
+
+template <typename T>
+void check_layouts(is::Pose const& pose, std::size_t n, double tolerance) {
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<> coordinate(-100.0, 100.0);
+  auto interleaved = std::vector<T>(3 * n);
+  for (auto& value : interleaved) { value = T(coordinate(gen)); }
+  auto x = std::vector<T>(n), y = std::vector<T>(n), z = std::vector<T>(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = interleaved[3 * i];
+    y[i] = interleaved[3 * i + 1];
+    z[i] = interleaved[3 * i + 2];
+  }
+  auto original = interleaved;
+
+  is::transform_points(pose, interleaved.data(), n);
+  is::transform_points(pose, x.data(), y.data(), z.data(), n);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    auto expected = transform(pose, original[3 * i], original[3 * i + 1], original[3 * i + 2]);
+    for (int axis = 0; axis < 3; ++axis) {
+      EXPECT_NEAR(interleaved[3 * i + axis], expected[axis], tolerance);
+    }
+    EXPECT_NEAR(x[i], expected[0], tolerance);
+    EXPECT_NEAR(y[i], expected[1], tolerance);
+    EXPECT_NEAR(z[i], expected[2], tolerance);
+  }
+}
+
+TEST(Points, Affine) {
+  std::mt19937 gen(42);
+  auto pose = is::random_pose(gen);
+  // Sizes that are not a multiple of any vector width leave a remainder
+  for (std::size_t n : {0, 1, 7, 33, 1000}) {
+    check_layouts<double>(pose, n, 1e-9);
+    check_layouts<float>(pose, n, 1e-3);
+  }
+}
+
+TEST(Points, Projective) {
+  std::mt19937 gen(42);
+  auto pose = is::random_pose(gen);
+  pose(3, 2) = 0.001;
+  pose(3, 3) = 2.0;
+  check_layouts<double>(pose, 100, 1e-9);
+  check_layouts<float>(pose, 100, 1e-3);
+}
+
+}  // namespace
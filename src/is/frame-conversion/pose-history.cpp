@@ -0,0 +1,76 @@
+#include "pose-history.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace is {
+
+PoseHistory::PoseHistory(std::size_t capacity, bool r)
+    : entries(std::max<std::size_t>(capacity, 1)), first(0), count(0), rigid(r) {}
+
+auto PoseHistory::entry(std::size_t position) const -> Entry const& {
+  return entries[(first + position) % entries.size()];
+}
+
+void PoseHistory::insert(Timestamp stamp, Pose const& pose) {
+  auto capacity = entries.size();
+  if (count == capacity) {
+    if (stamp < entry(0).stamp) return;
+    // Drop the oldest one
+    first = (first + 1) % capacity;
+    --count;
+  }
+
+  // Poses usually arrive in order, so only a few entries (if any) need to be shifted
+  auto position = count;
+  while (position > 0 && entry(position - 1).stamp > stamp) {
+    entries[(first + position) % capacity] = entry(position - 1);
+    --position;
+  }
+  entries[(first + position) % capacity] = Entry{stamp, pose};
+  ++count;
+}
+
+auto PoseHistory::at(Timestamp stamp) const -> Pose {
+  if (count == 0) throw std::out_of_range{"Empty pose history"};
+  if (stamp <= entry(0).stamp) return entry(0).pose;
+  if (stamp >= entry(count - 1).stamp) return entry(count - 1).pose;
+
+  // First entry after the given time, there is always one before it
+  auto lower = std::size_t{0};
+  auto upper = count - 1;
+  while (lower + 1 < upper) {
+    auto middle = (lower + upper) / 2;
+    if (entry(middle).stamp <= stamp) {
+      lower = middle;
+    } else {
+      upper = middle;
+    }
+  }
+
+  auto const& before = entry(lower);
+  auto const& after = entry(upper);
+  auto span = std::chrono::duration<double>(after.stamp - before.stamp).count();
+  auto elapsed = std::chrono::duration<double>(stamp - before.stamp).count();
+  if (span <= 0) return after.pose;
+  // SLERP only makes sense for rotations, any other matrix is interpolated element-wise
+  return rigid ? interpolate(before.pose, after.pose, elapsed / span)
+               : lerp(before.pose, after.pose, elapsed / span);
+}
+
+auto PoseHistory::size() const -> std::size_t {
+  return count;
+}
+
+auto PoseHistory::capacity() const -> std::size_t {
+  return entries.size();
+}
+
+auto PoseHistory::oldest() const -> Timestamp {
+  return entry(0).stamp;
+}
+
+auto PoseHistory::newest() const -> Timestamp {
+  return entry(count - 1).stamp;
+}
+
+}  // namespace is
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include "pose.hpp"
+
+namespace is {
+
+/* Bounded ring buffer with the last poses of an edge, ordered by the time they were taken. Once
+  full, every new pose replaces the oldest one. */
+class PoseHistory {
+ public:
+  using Timestamp = std::chrono::system_clock::time_point;
+
+ private:
+  struct Entry {
+    Timestamp stamp;
+    Pose pose;
+  };
+  std::vector<Entry> entries;
+  // Index of the oldest entry
+  std::size_t first;
+  std::size_t count;
+  // Rigid poses are interpolated with interpolate(), others with lerp()
+  bool rigid;
+
+  // Entry by its position in time, 0 being the oldest one
+  auto entry(std::size_t position) const -> Entry const&;
+
+ public:
+  explicit PoseHistory(std::size_t capacity = 1, bool rigid = true);
+
+  // Poses older than every stored one are dropped if the history is full
+  void insert(Timestamp, Pose const&);
+
+  /* Pose at the given time, interpolated from the two closest entries around it. Times outside
+    of the stored range give the closest entry, the history is never extrapolated. */
+  auto at(Timestamp) const -> Pose;
+
+  auto size() const -> std::size_t;
+  auto capacity() const -> std::size_t;
+  auto oldest() const -> Timestamp;
+  auto newest() const -> Timestamp;
+};
+
+}  // namespace is
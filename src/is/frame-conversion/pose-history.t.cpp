@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "pose-history.hpp"
+#include "test-support.hpp"
+
+namespace {
+
+auto at_x(double x) -> is::Pose {
+  auto pose = is::Pose::identity();
+  pose(0, 3) = x;
+  return pose;
+}
+
+TEST(PoseHistory, Interface) {
+  auto history = is::PoseHistory{3};
+  EXPECT_THROW(history.at(is::seconds(0)), std::out_of_range);
+
+  for (int i = 0; i < 4; ++i) { history.insert(is::seconds(i), at_x(10.0 * i)); }
+  // The first pose was replaced
+  ASSERT_EQ(history.size(), 3u);
+  ASSERT_EQ(history.capacity(), 3u);
+  ASSERT_EQ(history.oldest(), is::seconds(1));
+  ASSERT_EQ(history.newest(), is::seconds(3));
+
+  // Interpolated inside the range, clamped outside of it
+  EXPECT_NEAR(history.at(is::seconds(1.5))(0, 3), 15.0, 1e-9);
+  EXPECT_NEAR(history.at(is::seconds(2.75))(0, 3), 27.5, 1e-9);
+  EXPECT_NEAR(history.at(is::seconds(0.0))(0, 3), 10.0, 1e-9);
+  EXPECT_NEAR(history.at(is::seconds(9.0))(0, 3), 30.0, 1e-9);
+
+  // Out of order poses are placed by their time, too old ones are dropped
+  history.insert(is::seconds(2.5), at_x(0.0));
+  ASSERT_EQ(history.oldest(), is::seconds(2));
+  EXPECT_NEAR(history.at(is::seconds(2.5))(0, 3), 0.0, 1e-9);
+  history.insert(is::seconds(1), at_x(0.0));
+  ASSERT_EQ(history.oldest(), is::seconds(2));
+}
+
+TEST(PoseHistory, GeneralPoses) {
+  // Scales are not rotations, they are interpolated element-wise instead
+  auto scale = [](double s) {
+    auto pose = is::Pose::identity();
+    pose(0, 0) = pose(1, 1) = pose(2, 2) = s;
+    return pose;
+  };
+  auto history = is::PoseHistory{2, false};
+  history.insert(is::seconds(0), scale(1.0));
+  history.insert(is::seconds(1), scale(3.0));
+  auto pose = history.at(is::seconds(0.5));
+  for (int i = 0; i < 3; ++i) { EXPECT_NEAR(pose(i, i), 2.0, 1e-9); }
+  EXPECT_NEAR(pose(3, 3), 1.0, 1e-9);
+}
+
+}  // namespace
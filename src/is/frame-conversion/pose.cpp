@@ -0,0 +1,279 @@
+#include "pose.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace is {
+
+auto Pose::identity() -> Pose {
+  // clang-format off
+  return Pose{{{
+    1, 0, 0, 0,
+    0, 1, 0, 0,
+    0, 0, 1, 0,
+    0, 0, 0, 1
+  }}};
+  // clang-format on
+}
+
+auto operator*(Pose const& lhs, Pose const& rhs) -> Pose {
+  Pose out;
+  double const* b = rhs.data.data();
+#if defined(__AVX__)
+  // Each row of the result is a linear combination of the rows of "rhs", a full row fits on a
+  // single 256-bit register.
+  auto const b0 = _mm256_loadu_pd(b + 0);
+  auto const b1 = _mm256_loadu_pd(b + 4);
+  auto const b2 = _mm256_loadu_pd(b + 8);
+  auto const b3 = _mm256_loadu_pd(b + 12);
+  for (int i = 0; i < 4; ++i) {
+    double const* a = lhs.data.data() + 4 * i;
+    auto row = _mm256_mul_pd(_mm256_set1_pd(a[0]), b0);
+    row = _mm256_add_pd(row, _mm256_mul_pd(_mm256_set1_pd(a[1]), b1));
+    row = _mm256_add_pd(row, _mm256_mul_pd(_mm256_set1_pd(a[2]), b2));
+    row = _mm256_add_pd(row, _mm256_mul_pd(_mm256_set1_pd(a[3]), b3));
+    _mm256_storeu_pd(out.data.data() + 4 * i, row);
+  }
+#else
+  // Same row-wise formulation, written so the compiler can pack the inner loop into SSE lanes.
+  for (int i = 0; i < 4; ++i) {
+    double const* a = lhs.data.data() + 4 * i;
+    double* c = out.data.data() + 4 * i;
+    for (int j = 0; j < 4; ++j) {
+      c[j] = a[0] * b[j] + a[1] * b[4 + j] + a[2] * b[8 + j] + a[3] * b[12 + j];
+    }
+  }
+#endif
+  return out;
+}
+
+auto inverse(Pose const& pose) -> Pose {
+  auto const& m = pose.data;
+  // 2x2 sub-determinants of the two upper and the two lower rows
+  auto s0 = m[0] * m[5] - m[4] * m[1];
+  auto s1 = m[0] * m[6] - m[4] * m[2];
+  auto s2 = m[0] * m[7] - m[4] * m[3];
+  auto s3 = m[1] * m[6] - m[5] * m[2];
+  auto s4 = m[1] * m[7] - m[5] * m[3];
+  auto s5 = m[2] * m[7] - m[6] * m[3];
+  auto c5 = m[10] * m[15] - m[14] * m[11];
+  auto c4 = m[9] * m[15] - m[13] * m[11];
+  auto c3 = m[9] * m[14] - m[13] * m[10];
+  auto c2 = m[8] * m[15] - m[12] * m[11];
+  auto c1 = m[8] * m[14] - m[12] * m[10];
+  auto c0 = m[8] * m[13] - m[12] * m[9];
+
+  auto det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  auto k = 1.0 / det;
+
+  Pose out;
+  auto& o = out.data;
+  o[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * k;
+  o[1] = (-m[1] * c5 + m[2] * c4 - m[3] * c3) * k;
+  o[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * k;
+  o[3] = (-m[9] * s5 + m[10] * s4 - m[11] * s3) * k;
+  o[4] = (-m[4] * c5 + m[6] * c2 - m[7] * c1) * k;
+  o[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * k;
+  o[6] = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * k;
+  o[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * k;
+  o[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * k;
+  o[9] = (-m[0] * c4 + m[1] * c2 - m[3] * c0) * k;
+  o[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * k;
+  o[11] = (-m[8] * s4 + m[9] * s2 - m[11] * s0) * k;
+  o[12] = (-m[4] * c3 + m[5] * c1 - m[6] * c0) * k;
+  o[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * k;
+  o[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * k;
+  o[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * k;
+  return out;
+}
+
+auto determinant(Pose const& pose) -> double {
+  auto const& m = pose.data;
+  auto s0 = m[0] * m[5] - m[4] * m[1];
+  auto s1 = m[0] * m[6] - m[4] * m[2];
+  auto s2 = m[0] * m[7] - m[4] * m[3];
+  auto s3 = m[1] * m[6] - m[5] * m[2];
+  auto s4 = m[1] * m[7] - m[5] * m[3];
+  auto s5 = m[2] * m[7] - m[6] * m[3];
+  auto c5 = m[10] * m[15] - m[14] * m[11];
+  auto c4 = m[9] * m[15] - m[13] * m[11];
+  auto c3 = m[9] * m[14] - m[13] * m[10];
+  auto c2 = m[8] * m[15] - m[12] * m[11];
+  auto c1 = m[8] * m[14] - m[12] * m[10];
+  auto c0 = m[8] * m[13] - m[12] * m[9];
+  return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+auto rigid_inverse(Pose const& pose) -> Pose {
+  auto const& m = pose.data;
+  // clang-format off
+  return Pose{{{
+    m[0], m[4], m[8],  -(m[0] * m[3] + m[4] * m[7] + m[8] * m[11]),
+    m[1], m[5], m[9],  -(m[1] * m[3] + m[5] * m[7] + m[9] * m[11]),
+    m[2], m[6], m[10], -(m[2] * m[3] + m[6] * m[7] + m[10] * m[11]),
+       0,    0,     0,  1
+  }}};
+  // clang-format on
+}
+
+auto is_rigid(Pose const& pose, double tolerance) -> bool {
+  auto const& m = pose.data;
+  if (std::abs(m[12]) > tolerance || std::abs(m[13]) > tolerance || std::abs(m[14]) > tolerance ||
+      std::abs(m[15] - 1.0) > tolerance) {
+    return false;
+  }
+  // R^T * R must be the identity
+  for (int i = 0; i < 3; ++i) {
+    for (int j = i; j < 3; ++j) {
+      auto dot = m[i] * m[j] + m[4 + i] * m[4 + j] + m[8 + i] * m[8 + j];
+      if (std::abs(dot - (i == j ? 1.0 : 0.0)) > tolerance) return false;
+    }
+  }
+  // and det(R) must be +1, otherwise it is a reflection
+  auto det = m[0] * (m[5] * m[10] - m[6] * m[9]) - m[1] * (m[4] * m[10] - m[6] * m[8]) +
+             m[2] * (m[4] * m[9] - m[5] * m[8]);
+  return det > 0.0;
+}
+
+auto is_singular(Pose const& pose, double tolerance) -> bool {
+  auto bound = 1.0;
+  for (int row = 0; row < 4; ++row) {
+    auto squared = 0.0;
+    for (int col = 0; col < 4; ++col) {
+      // The translation does not change the determinant of a [A t; 0 1] matrix, so it is left
+      // out of the bound
+      if (col == 3 && row < 3) continue;
+      squared += pose(row, col) * pose(row, col);
+    }
+    bound *= std::sqrt(squared);
+  }
+  return std::abs(determinant(pose)) <= tolerance * bound;
+}
+
+namespace {
+// Unit quaternion stored as (w, x, y, z)
+using Quaternion = std::array<double, 4>;
+
+auto to_quaternion(Pose const& pose) -> Quaternion {
+  auto const& m = pose.data;
+  auto trace = m[0] + m[5] + m[10];
+  // Pick the largest component as pivot to keep the division well conditioned
+  if (trace > 0) {
+    auto s = 2.0 * std::sqrt(trace + 1.0);
+    return {{s / 4, (m[9] - m[6]) / s, (m[2] - m[8]) / s, (m[4] - m[1]) / s}};
+  } else if (m[0] > m[5] && m[0] > m[10]) {
+    auto s = 2.0 * std::sqrt(1.0 + m[0] - m[5] - m[10]);
+    return {{(m[9] - m[6]) / s, s / 4, (m[1] + m[4]) / s, (m[2] + m[8]) / s}};
+  } else if (m[5] > m[10]) {
+    auto s = 2.0 * std::sqrt(1.0 + m[5] - m[0] - m[10]);
+    return {{(m[2] - m[8]) / s, (m[1] + m[4]) / s, s / 4, (m[6] + m[9]) / s}};
+  }
+  auto s = 2.0 * std::sqrt(1.0 + m[10] - m[0] - m[5]);
+  return {{(m[4] - m[1]) / s, (m[2] + m[8]) / s, (m[6] + m[9]) / s, s / 4}};
+}
+
+auto slerp(Quaternion const& a, Quaternion b, double t) -> Quaternion {
+  auto dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  // q and -q are the same rotation, take the shortest arc
+  if (dot < 0) {
+    for (auto& value : b) { value = -value; }
+    dot = -dot;
+  }
+
+  auto wa = 1.0 - t;
+  auto wb = t;
+  // Nearly parallel, fallback to a linear interpolation to avoid dividing by sin(~0)
+  if (dot < 0.9995) {
+    auto theta = std::acos(dot);
+    wa = std::sin(wa * theta) / std::sin(theta);
+    wb = std::sin(wb * theta) / std::sin(theta);
+  }
+
+  auto q = Quaternion{};
+  auto norm = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    q[i] = wa * a[i] + wb * b[i];
+    norm += q[i] * q[i];
+  }
+  norm = std::sqrt(norm);
+  for (auto& value : q) { value /= norm; }
+  return q;
+}
+}  // namespace
+
+auto interpolate(Pose const& from, Pose const& to, double t) -> Pose {
+  auto q = slerp(to_quaternion(from), to_quaternion(to), t);
+  auto w = q[0], x = q[1], y = q[2], z = q[3];
+  auto lerp = [&](int i) { return (1.0 - t) * from.data[i] + t * to.data[i]; };
+  // clang-format off
+  return Pose{{{
+    1 - 2 * (y * y + z * z),     2 * (x * y - z * w),     2 * (x * z + y * w), lerp(3),
+        2 * (x * y + z * w), 1 - 2 * (x * x + z * z),     2 * (y * z - x * w), lerp(7),
+        2 * (x * z - y * w),     2 * (y * z + x * w), 1 - 2 * (x * x + y * y), lerp(11),
+                          0,                       0,                       0, 1
+  }}};
+  // clang-format on
+}
+
+auto lerp(Pose const& from, Pose const& to, double t) -> Pose {
+  auto pose = Pose{};
+  for (std::size_t i = 0; i < pose.data.size(); ++i) {
+    pose.data[i] = (1.0 - t) * from.data[i] + t * to.data[i];
+  }
+  return pose;
+}
+
+auto rotation_distance(Pose const& lhs, Pose const& rhs) -> double {
+  // Trace of lhs^T * rhs, the relative rotation, is 1 + 2 cos(angle)
+  auto trace = 0.0;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) { trace += lhs(row, col) * rhs(row, col); }
+  }
+  return std::acos(std::max(-1.0, std::min(1.0, (trace - 1.0) / 2.0)));
+}
+
+auto translation_distance(Pose const& lhs, Pose const& rhs) -> double {
+  auto dx = lhs(0, 3) - rhs(0, 3);
+  auto dy = lhs(1, 3) - rhs(1, 3);
+  auto dz = lhs(2, 3) - rhs(2, 3);
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+auto to_pose(common::Tensor const& tensor) -> Pose {
+  auto const& dims = tensor.shape().dims();
+  if (dims.size() != 2 || dims.Get(0).size() != 4 || dims.Get(1).size() != 4) {
+    throw std::invalid_argument{"A transformation must be a 4x4 tensor"};
+  }
+
+  Pose pose;
+  if (tensor.type() == common::DataType::DOUBLE_TYPE && tensor.doubles_size() == 16) {
+    std::copy(tensor.doubles().begin(), tensor.doubles().end(), pose.data.begin());
+  } else if (tensor.type() == common::DataType::FLOAT_TYPE && tensor.floats_size() == 16) {
+    std::copy(tensor.floats().begin(), tensor.floats().end(), pose.data.begin());
+  } else {
+    throw std::invalid_argument{"A transformation must contain 16 float or double values"};
+  }
+  return pose;
+}
+
+auto to_tensor(Pose const& pose) -> common::Tensor {
+  common::Tensor tensor;
+  auto shape = tensor.mutable_shape();
+  auto rows = shape->add_dims();
+  rows->set_size(4);
+  rows->set_name("rows");
+  auto cols = shape->add_dims();
+  cols->set_size(4);
+  cols->set_name("cols");
+
+  tensor.set_type(common::DataType::DOUBLE_TYPE);
+  auto doubles = tensor.mutable_doubles();
+  doubles->Reserve(16);
+  for (auto value : pose.data) { doubles->AddAlreadyReserved(value); }
+  return tensor;
+}
+
+}  // namespace is
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <is/msgs/common.pb.h>
+#include <array>
+
+namespace is {
+
+/* Homogeneous 4x4 transformation stored inline as a row-major block of doubles, e.g:
+    | r00 r01 r02 tx |
+    | r10 r11 r12 ty |
+    | r20 r21 r22 tz |
+    |   0   0   0  1 |
+  Being a plain value type it can live directly on the edge map and on the stack, so composing a
+  path never touches the heap nor the protobuf representation. */
+struct Pose {
+  std::array<double, 16> data;
+
+  static auto identity() -> Pose;
+
+  auto operator()(int row, int col) -> double& { return data[4 * row + col]; }
+  auto operator()(int row, int col) const -> double { return data[4 * row + col]; }
+};
+
+// Composition of two transformations, i.e. the matrix product "lhs * rhs"
+auto operator*(Pose const& lhs, Pose const& rhs) -> Pose;
+// General inverse of a 4x4 matrix
+auto inverse(Pose const&) -> Pose;
+auto determinant(Pose const&) -> double;
+
+// Closed-form inverse of a rigid transformation [R t] -> [R^T -R^T*t]
+auto rigid_inverse(Pose const&) -> Pose;
+// Check if the rotation block is orthonormal, the last row is [0 0 0 1] and there is no reflection
+auto is_rigid(Pose const&, double tolerance = 1e-3) -> bool;
+/* Check if the determinant is negligible relative to the product of the norms of the rows (its
+  upper bound, see Hadamard's inequality), so the test does not depend on the scale of the units */
+auto is_singular(Pose const&, double tolerance = 1e-10) -> bool;
+/* Rigid transformation in between the two given ones, where t = 0 gives "from" and t = 1 gives
+  "to". The rotation is interpolated on the unit sphere (SLERP) and the translation linearly. */
+auto interpolate(Pose const& from, Pose const& to, double t) -> Pose;
+// Same, for any matrix, by interpolating each of the elements linearly
+auto lerp(Pose const& from, Pose const& to, double t) -> Pose;
+
+/* Angle in radians of the rotation between the rotation blocks of the two transformations, i.e.
+  how much one of them has to rotate to get to the other. Both are assumed to be rigid. */
+auto rotation_distance(Pose const&, Pose const&) -> double;
+// Euclidean distance between the translations of the two transformations
+auto translation_distance(Pose const&, Pose const&) -> double;
+
+// Conversions from/to the protobuf representation, only used at the service boundaries
+auto to_pose(common::Tensor const&) -> Pose;
+auto to_tensor(Pose const&) -> common::Tensor;
+
+}  // namespace is
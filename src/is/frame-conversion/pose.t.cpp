@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <is/msgs/cv.hpp>
+#include <random>
+#include "pose.hpp"
+#include "test-expectations.hpp"
+#include "test-support.hpp"
+
+namespace {
+
+void expect_equal(is::Pose const& pose, cv::Mat const& mat) {
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      EXPECT_NEAR(pose(row, col), mat.at<double>(row, col), 1e-9);
+    }
+  }
+}
+
+TEST(Pose, Interface) {
+  std::mt19937 gen(1);
+  auto cv1 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+  auto cv2 = is::to_mat(is::to_tensor(is::random_pose(gen)));
+
+  auto p1 = is::to_pose(is::to_tensor(cv1));
+  auto p2 = is::to_pose(is::to_tensor(cv2));
+  expect_equal(p1, cv1);
+
+  expect_equal(is::Pose::identity() * p1, cv1);
+  expect_equal(p1 * p2, cv1 * cv2);
+  expect_equal(is::inverse(p1), cv1.inv());
+
+  // Round trip through the protobuf representation
+  expect_equal(is::to_pose(is::to_tensor(p1 * p2)), cv1 * cv2);
+
+  // Rigid transformations
+  EXPECT_TRUE(is::is_rigid(p1));
+  expect_equal(is::rigid_inverse(p1), cv1.inv());
+  auto scaled = p1;
+  scaled(0, 0) *= 2.0;
+  EXPECT_FALSE(is::is_rigid(scaled));
+  auto reflected = p1;
+  for (int col = 0; col < 3; ++col) { reflected(2, col) *= -1.0; }
+  EXPECT_FALSE(is::is_rigid(reflected));
+
+  // Singularity does not depend on the scale of the units, e.g. meters or micrometers
+  EXPECT_FALSE(is::is_singular(p1));
+  auto tiny = is::Pose::identity();
+  for (int i = 0; i < 3; ++i) { tiny(i, i) = 1e-6; }
+  EXPECT_FALSE(is::is_singular(tiny));
+  auto flat = p1;
+  for (int col = 0; col < 3; ++col) { flat(2, col) = 1e6 * (flat(0, col) + 1e-12 * flat(1, col)); }
+  EXPECT_TRUE(is::is_singular(flat));
+
+  // Interpolation ends at the given poses and halfway rotates by half the angle
+  auto rotation = [](double theta) {
+    auto pose = is::Pose::identity();
+    pose(0, 0) = std::cos(theta);
+    pose(0, 1) = -std::sin(theta);
+    pose(1, 0) = std::sin(theta);
+    pose(1, 1) = std::cos(theta);
+    return pose;
+  };
+  expect_equal(is::interpolate(p1, p2, 0.0), cv1);
+  expect_equal(is::interpolate(p1, p2, 1.0), cv2);
+  auto from = rotation(0.2);
+  auto to = rotation(2.2);
+  to(0, 3) = 4.0;
+  auto halfway = rotation(1.2);
+  halfway(0, 3) = 2.0;
+  auto interpolated = is::interpolate(from, to, 0.5);
+  is::expect_equal(interpolated, halfway);
+
+  // Distances between transformations
+  EXPECT_NEAR(is::rotation_distance(from, to), 2.0, 1e-9);
+  EXPECT_NEAR(is::rotation_distance(p1, p1), 0.0, 1e-6);
+  EXPECT_NEAR(is::translation_distance(from, to), 4.0, 1e-9);
+  EXPECT_NEAR(is::translation_distance(p1, p1), 0.0, 1e-9);
+
+  auto wrong_shape = is::common::Tensor{};
+  wrong_shape.mutable_shape()->add_dims()->set_size(16);
+  EXPECT_THROW(is::to_pose(wrong_shape), std::invalid_argument);
+}
+
+}  // namespace
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "pose.hpp"
+
+namespace is {
+
+// Every element of the two poses must be within the given tolerance
+inline void expect_equal(Pose const& l, Pose const& r, double tolerance = 1e-9) {
+  for (std::size_t i = 0; i < l.data.size(); ++i) { EXPECT_NEAR(l.data[i], r.data[i], tolerance); }
+}
+
+}  // namespace is
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include "pose-history.hpp"
+#include "pose.hpp"
+
+/* Inputs shared by the tests and the benchmarks, header only and without gtest so the benchmark
+  support library can use them too. The gtest side is on test-expectations.hpp. */
+
+namespace is {
+
+// Random rigid transformation, rotated around the z and y axes
+inline auto random_pose(std::mt19937& gen) -> Pose {
+  std::uniform_real_distribution<> angle(-M_PI, M_PI);
+  std::uniform_real_distribution<> position(-10.0, 10.0);
+  auto yaw = angle(gen);
+  auto pitch = angle(gen) / 2.0;
+  auto pose = Pose::identity();
+  pose(0, 0) = std::cos(yaw) * std::cos(pitch);
+  pose(0, 1) = -std::sin(yaw);
+  pose(0, 2) = std::cos(yaw) * std::sin(pitch);
+  pose(1, 0) = std::sin(yaw) * std::cos(pitch);
+  pose(1, 1) = std::cos(yaw);
+  pose(1, 2) = std::sin(yaw) * std::sin(pitch);
+  pose(2, 0) = -std::sin(pitch);
+  pose(2, 1) = 0.0;
+  pose(2, 2) = std::cos(pitch);
+  pose(0, 3) = position(gen);
+  pose(1, 3) = position(gen);
+  pose(2, 3) = position(gen);
+  return pose;
+}
+
+// Time point the given number of seconds after the epoch
+inline auto seconds(double s) -> PoseHistory::Timestamp {
+  return PoseHistory::Timestamp{} +
+         std::chrono::duration_cast<std::chrono::system_clock::duration>(
+             std::chrono::duration<double>(s));
+}
+
+}  // namespace is